@@ -30,27 +30,44 @@
 #include <stdbool.h>
 
 #include <getopt.h>
-#include <sys/time.h>
 
 #include "BitBltDispatch.h"
+#include "BitBltBatch.h"
+#include "BitBltParallel.h"
+#include "BenchTiming.h"
+#include "BenchReport.h"
+#include "BenchCache.h"
+#include "BenchCounters.h"
+#include "BenchSurface.h"
+#ifdef __x86_64__
+#include "BitBltX64.h"
+#endif
 
 #define sqInt int
 
 extern sqInt initialiseModule(void);
 
-#define CACHELINELEN (32)
-#define L1CACHESIZE (16*1024)
-#define L2CACHESIZE (128*1024)
 #define KILOBYTE (1024)
 #define MEGABYTE (1024*1024)
 
-#define HALFL2CACHE (L2CACHESIZE/2 - 4*KILOBYTE)
+/* The memory test wants a destination well beyond the last level cache, but
+ * there's no point going beyond this */
+#define MAXDRAMSIZE (256*MEGABYTE)
+
 #define TESTSIZE (40*MEGABYTE)
+#define SWEEPTESTSIZE (4*MEGABYTE)
+#define SWEEPTIMELIMIT (250000000ull)
 
 #define SCREENWIDTH (1920)
 #define SCREENHEIGHT (1080)
 #define TILEWIDTH (32)
 #define TINYWIDTH (8)
+#define TILEHEIGHT (32)
+#define TINYHEIGHT (16)
+#define ALIGNMENTS (256)
+
+#define BATCHSIZE (4096)
+#define BATCHREPEATS (64)
 
 static unsigned int  maskTable53[4] = { 0x7000, 0x0380, 0x001C, 0x0000 };
 static          int shiftTable53[4] = {     -6,     -4,     -2,      0 };
@@ -65,11 +82,29 @@ static          int shiftTable84[4] = {      -12,       -8,       -4,        0 }
 static unsigned int  maskTable85[4] = { 0xF80000, 0x00F800, 0x0000F8, 0x000000 };
 static          int shiftTable85[4] = {       -9,       -6,       -3,        0 };
 static uint32_t      lookupTable[2][32768];
-
-static uint32_t src[SCREENHEIGHT][SCREENWIDTH];
-static uint32_t dest[SCREENHEIGHT][SCREENWIDTH];
+static uint32_t      halftoneWord[1] = { 0x55555555 };
+
+/* At least a screen's worth, but big enough for the memory test. Each
+ * measurement starts from the pristine destination. */
+static bench_surface_t srcSurface;
+static bench_surface_t destSurface;
+static uint32_t (*src)[SCREENWIDTH];
+static uint32_t (*dest)[SCREENWIDTH];
+static size_t surfaceBytes;
+static size_t dramBytes;
+static blit_rect_t batch[BATCHSIZE];
+static uint32_t testSize = TESTSIZE;
+static uint8_t alignment[ALIGNMENTS];
 
 static operation_t op;
+static void (*dispatch)(operation_t *) = copyBitsDispatch;
+
+static int format = REPORT_TEXT;
+static const struct option longOptions[] = {
+	{ "csv",  no_argument, &format, REPORT_CSV  },
+	{ "json", no_argument, &format, REPORT_JSON },
+	{ NULL,   0,           NULL,    0           },
+};
 
 static const struct {
 	const char *string;
@@ -134,29 +169,64 @@ static void plot(size_t s_x, size_t s_y, size_t d_x, size_t d_y, size_t w, size_
 	op.width = w;
 	op.height = h;
 
-	copyBitsDispatch(&op);
+	dispatch(&op);
 }
 
-static uint64_t gettime(void)
+/* Note the part of the destination that a case's blits can reach: each
+ * starts on row 0, no more than 63 pixels in */
+static void touch(uint32_t width, uint32_t height)
 {
-	struct timeval tv;
+	bench_rect_t r = benchSurfaceRect(&destSurface, op.dest.pitch, op.dest.depth, 0, 0, 64 + width, height);
+	benchSurfaceDirty(&destSurface, &r);
+}
 
-	gettimeofday (&tv, NULL);
-	return tv.tv_sec * 1000000 + tv.tv_usec;
+/* Depths are passed as log2 of the bits per pixel, so that 1, 2 and 4bpp are
+ * accounted for correctly */
+#define BYTES(pixels, log2Bpp) ((uint32_t) (((uint64_t) (pixels) << (log2Bpp)) / 8))
+
+static uint32_t log2Depth(uint32_t depth)
+{
+	uint32_t log2 = 0;
+	while ((1u << log2) < depth)
+		log2++;
+	return log2;
 }
 
-static uint32_t bench_L(void (*test)(), uint32_t log2Bpp, bool l2)
+/* The source surface is no bigger than the destination, but is walked with
+ * its own pitch, so the number of rows a blit can cover is set by whichever
+ * of the two is deeper */
+static uint32_t log2RowBpp(uint32_t log2Bpp)
 {
-	uint32_t width = SCREENWIDTH - 64;
-	uint32_t height = l2 ? (HALFL2CACHE / SCREENWIDTH) >> log2Bpp : 1;
-	uint32_t times = TESTSIZE / ((width * height) << log2Bpp);
-	uint32_t words = (SCREENWIDTH * height) >> (2 - log2Bpp);
+	uint32_t log2SrcBpp = op.noSource ? 0 : log2Depth(op.src.depth);
+	return log2SrcBpp > log2Bpp ? log2SrcBpp : log2Bpp;
+}
+
+/* Size a blit so that the deeper of its surfaces fills about half of a cache
+ * of the given size, leaving a little room for everything else */
+static void fit_cache(size_t cacheSize, uint32_t log2Bpp, uint32_t *width, uint32_t *height)
+{
+	size_t slack = cacheSize / 8 < 4*KILOBYTE ? cacheSize / 8 : 4*KILOBYTE;
+	uint64_t pixels = ((uint64_t) (cacheSize / 2 - slack) * 8) >> log2Bpp;
+	*width = pixels < SCREENWIDTH - 64 ? pixels : SCREENWIDTH - 64;
+	*height = pixels < SCREENWIDTH ? 1 : pixels / SCREENWIDTH;
+}
+
+static uint32_t bench_L(void (*test)(), uint32_t log2Bpp, size_t cacheSize)
+{
+	uint32_t width, height;
+	fit_cache(cacheSize, log2RowBpp(log2Bpp), &width, &height);
+	uint32_t times = testSize / BYTES(width * height, log2Bpp);
+	uint32_t words = BYTES((uint64_t) SCREENWIDTH * height, log2Bpp) / sizeof **dest;
+	uint32_t stride = benchCacheInfo()->line / sizeof **dest;
 	int i, j, x = 0, q = 0;
 	volatile int qx;
-	for (i = times; i >= 0; i--)
+	if (times == 0)
+		times = 1;
+	touch(width, height);
+	for (i = times; i > 0; i--)
 	{
 		/* Ensure the destination is in cache (if it gets flushed out, source gets reloaded anyway) */
-		for (j = 0; (unsigned) j < words; j += CACHELINELEN / sizeof **dest)
+		for (j = 0; (unsigned) j < words; j += stride)
 			q += dest[0][j];
 		q += dest[0][words-1];
 
@@ -165,78 +235,185 @@ static uint32_t bench_L(void (*test)(), uint32_t log2Bpp, bool l2)
 	}
 	qx = q;
 	(void) qx;
-	return (width * height * times) << log2Bpp;
+	return BYTES((uint64_t) width * height * times, log2Bpp);
 }
 
 static uint32_t bench_M(void (*test)(), uint32_t log2Bpp)
 {
 	uint32_t width = SCREENWIDTH - 64;
-	uint32_t height = SCREENHEIGHT;
-	uint32_t times = TESTSIZE / ((width * height) << log2Bpp);
+	uint32_t height = ((uint64_t) dramBytes * 8 / SCREENWIDTH) >> log2RowBpp(log2Bpp);
+	uint32_t times = testSize / BYTES((uint64_t) width * height, log2Bpp);
 	int i, x = 0;
-	for (i = times; i >= 0; i--)
+	if (times == 0)
+		times = 1;
+	touch(width, height);
+	for (i = times; i > 0; i--)
 	{
 		x = (x + 1) & 63;
 		test(x, 0, 63 - x, 0, width, height);
 	}
-	return (width * height * times) << log2Bpp;
+	return BYTES((uint64_t) width * height * times, log2Bpp);
 }
 
-void warning(const char *message)
+static void init_alignment(void)
 {
-    (void) message;
-//    fprintf(stderr, "warning: %s\n", message);
+	/* Icons and glyphs land at arbitrary x positions, so vary the source and
+	 * destination alignment independently without paying for rand() in the
+	 * timed loop */
+	srand(1);
+	for (size_t i = 0; i < ALIGNMENTS; i++)
+		alignment[i] = rand() & 63;
 }
 
-int main(int argc, char *argv[])
+static uint32_t bench_S(void (*test)(), uint32_t log2Bpp, uint32_t width, uint32_t height, uint32_t *blit_cnt)
 {
-	uint64_t t1, t2, t3;
-	uint32_t byte_cnt;
-	size_t iterations = 1;
-	bool scalarHalftone = false;
-	uint32_t map_width = 0;
+	uint32_t times = testSize / BYTES(width * height, log2Bpp);
+	int i;
+	if (times == 0)
+		times = 1;
+	touch(width, height);
+	for (i = times; i > 0; i--)
+		test(alignment[i % ALIGNMENTS], 0, alignment[(i + 1) % ALIGNMENTS], 0, width, height);
+	*blit_cnt = times;
+	return BYTES(width * height * times, log2Bpp);
+}
 
-	bool help = false;
-	int opt;
-	while ((opt = getopt(argc, argv, "hi:nsm:")) != -1) {
-		switch (opt) {
-		case 'h': help = true; break;
-		case 'i': iterations = atoi(optarg); break;
-		case 'n': op.noSource = true; break;
-		case 's': scalarHalftone = true; break;
-		case 'm': map_width = atoi(optarg); break;
-		}
+static void init_batch(void)
+{
+	/* Tiny blits scattered across the screen, like glyphs in a paragraph */
+	srand(0);
+	for (size_t i = 0; i < BATCHSIZE; i++) {
+		batch[i].src_x = rand() % (SCREENWIDTH - TINYWIDTH);
+		batch[i].src_y = rand() % (SCREENHEIGHT - TINYWIDTH);
+		batch[i].dest_x = rand() % (SCREENWIDTH - TINYWIDTH);
+		batch[i].dest_y = rand() % (SCREENHEIGHT - TINYWIDTH);
+		batch[i].width = TINYWIDTH;
+		batch[i].height = TINYWIDTH;
 	}
-	if (help || optind == argc) {
-bad_syntax:
-		fprintf(stderr, "Syntax: %s [-h] [-i iterations] [-n] [-s] [-m map width] combinationRule [srcDepth] destDepth\n", argv[0]);
-		exit(EXIT_FAILURE);
+}
+
+static void bench_batch(void *batched)
+{
+	int i;
+	size_t j;
+	for (i = BATCHREPEATS; i > 0; i--)
+	{
+		if (*(bool *) batched)
+			copyBitsDispatchBatch(&op, batch, BATCHSIZE);
+		else
+			for (j = 0; j < BATCHSIZE; j++)
+				plot(batch[j].src_x, batch[j].src_y, batch[j].dest_x, batch[j].dest_y, batch[j].width, batch[j].height);
 	}
-	size_t i;
-	for (i = 0; i < sizeof crTable / sizeof *crTable; i++) {
-		if (strcmp(argv[optind], crTable[i].string) == 0) {
-			op.combinationRule = crTable[i].number;
-			break;
+}
+
+static uint32_t case_L1(void (*test)(), uint32_t log2Bpp, uint32_t *blit_cnt)
+{
+	*blit_cnt = 0;
+	return bench_L(test, log2Bpp, benchCacheInfo()->l1);
+}
+
+static uint32_t case_L2(void (*test)(), uint32_t log2Bpp, uint32_t *blit_cnt)
+{
+	*blit_cnt = 0;
+	return bench_L(test, log2Bpp, benchCacheInfo()->l2);
+}
+
+static uint32_t case_LLC(void (*test)(), uint32_t log2Bpp, uint32_t *blit_cnt)
+{
+	*blit_cnt = 0;
+	return bench_L(test, log2Bpp, benchCacheInfo()->llc);
+}
+
+static uint32_t case_M(void (*test)(), uint32_t log2Bpp, uint32_t *blit_cnt)
+{
+	*blit_cnt = 0;
+	return bench_M(test, log2Bpp);
+}
+
+static uint32_t case_tile(void (*test)(), uint32_t log2Bpp, uint32_t *blit_cnt)
+{
+	return bench_S(test, log2Bpp, TILEWIDTH, TILEHEIGHT, blit_cnt);
+}
+
+static uint32_t case_tiny(void (*test)(), uint32_t log2Bpp, uint32_t *blit_cnt)
+{
+	return bench_S(test, log2Bpp, TINYWIDTH, TINYHEIGHT, blit_cnt);
+}
+
+static const struct {
+	const char *string;
+	uint32_t (*run)(void (*test)(), uint32_t log2Bpp, uint32_t *blit_cnt);
+} caseTable[] = {
+	{ "L1",   case_L1,   },
+	{ "L2",   case_L2,   },
+	{ "LLC",  case_LLC,  },
+	{ "M",    case_M,    },
+	{ "Tile", case_tile, },
+	{ "Tiny", case_tiny, },
+};
+
+#define NCASES (sizeof caseTable / sizeof *caseTable)
+
+static bool sweeping;
+static bool counting;
+
+typedef struct {
+	size_t index;
+	void (*test)();
+	uint32_t log2Bpp;
+	uint32_t byte_cnt;
+	uint32_t blit_cnt;
+	double perPixel[BENCH_COUNTERS];
+} measurement_t;
+
+static void run_case(void *arg)
+{
+	measurement_t *m = arg;
+	m->byte_cnt = caseTable[m->index].run(m->test, m->log2Bpp, &m->blit_cnt);
+}
+
+static void measure(measurement_t *m, bench_stats_t *stats)
+{
+	bench_stats_t overheads;
+
+	benchSurfaceRestore(&destSurface);
+	m->test = control;
+	benchMeasure(run_case, m, &overheads);
+	m->test = plot;
+	benchMeasure(run_case, m, stats);
+	benchSubtractControl(stats, &overheads);
+	if (!stats->converged && !sweeping)
+		fprintf(stderr, "warning: %s did not converge after %u samples\n", caseTable[m->index].string, stats->samples);
+
+	if (counting) {
+		/* One more run of each, counted rather than timed */
+		double overheadCounts[BENCH_COUNTERS];
+		m->test = control;
+		benchCountersStart();
+		run_case(m);
+		benchCountersStop(overheadCounts);
+		m->test = plot;
+		benchCountersStart();
+		run_case(m);
+		benchCountersStop(m->perPixel);
+		double pixels = ((double) m->byte_cnt * 8) / (1u << m->log2Bpp);
+		for (int i = 0; i < BENCH_COUNTERS; i++) {
+			if (m->perPixel[i] < 0 || overheadCounts[i] < 0)
+				m->perPixel[i] = -1;
+			else if (m->perPixel[i] < overheadCounts[i])
+				m->perPixel[i] = 0;
+			else
+				m->perPixel[i] = (m->perPixel[i] - overheadCounts[i]) / pixels;
 		}
 	}
-	if (i == sizeof crTable / sizeof *crTable) {
-		fprintf(stderr, "Unrecognised combinationRule\n");
-		exit(EXIT_FAILURE);
-	}
-	if (op.combinationRule == CR_clearWord || op.combinationRule == CR_destinationWord || op.combinationRule == CR_bitInvertDestination)
-		op.noSource = true;
-	if ((op.noSource && optind != argc - 2) || (!op.noSource && optind != argc - 3))
-		goto bad_syntax;
-	op.src.depth = atoi(argv[optind + 1]);
-	op.dest.depth = atoi(argv[argc - 1]);
-	if (op.src.depth < 1 || op.src.depth > 32 || (op.src.depth & (op.src.depth-1)) != 0 || op.dest.depth < 1 || op.dest.depth > 32 || (op.dest.depth & (op.dest.depth-1)) != 0) {
-		fprintf(stderr, "Bad colour depth\n");
-		exit(EXIT_FAILURE);
-	}
+}
 
-	/* First lookup table is non-uniform, suitable for 9-bit or wider maps with 16 or 32bpp */
-	memset(lookupTable, 0xAA, sizeof lookupTable);
-	lookupTable[0][1] = 0x55555555;
+/* Fill in the surfaces, colour map and halftone of op for its combination
+ * rule and depths. Returns NULL on success, or a message describing why
+ * map_width is unsuitable for the source depth. */
+static const char *configure(bool scalarHalftone, uint32_t map_width)
+{
+	static char message[40];
 
 	op.src.bits = src;
 	op.src.pitch = (SCREENWIDTH * op.src.depth / 8 + 3) &~ 3;
@@ -308,8 +485,7 @@ bad_syntax:
 			op.cmLookupTable = &lookupTable[0];
 			break;
 		default:
-			fprintf(stderr, "Invalid map width for 32bpp\n");
-			exit(EXIT_FAILURE);
+			return "Invalid map width for 32bpp";
 		}
 	} else if (op.src.depth == 16) {
 		switch (map_width) {
@@ -342,8 +518,7 @@ bad_syntax:
 			op.cmLookupTable = &lookupTable[0];
 			break;
 		default:
-			fprintf(stderr, "Invalid map width for 16bpp\n");
-			exit(EXIT_FAILURE);
+			return "Invalid map width for 16bpp";
 		}
 	} else {
 		if (map_width == 1) {
@@ -353,68 +528,367 @@ bad_syntax:
 			op.cmMask = (1u << map_width) - 1;
 			op.cmLookupTable = &lookupTable[0];
 		} else if (map_width != 0) {
-			fprintf(stderr, "Invalid map width for %"PRIdSQINT"bpp\n", op.src.depth);
-			exit(EXIT_FAILURE);
+			snprintf(message, sizeof message, "Invalid map width for %"PRIdSQINT"bpp", op.src.depth);
+			return message;
 		}
 	}
 	if (scalarHalftone) {
-		uint32_t oneWord[1] = { 0x55555555 };
 		op.noHalftone = 0;
 		op.halftoneHeight = 1;
-		op.halftoneBase = &oneWord;
+		op.halftoneBase = &halftoneWord;
 	} else {
 		op.noHalftone = 1;
 		op.halftoneHeight = 0;
 		op.halftoneBase = NULL;
 	}
+	return NULL;
+}
+
+static bool ruleHasNoSource(combination_rule_t rule)
+{
+	return rule == CR_clearWord || rule == CR_destinationWord || rule == CR_bitInvertDestination;
+}
 
-	uint32_t log2destBpp = 0;
-	switch (op.dest.depth) {
-	case 8:  log2destBpp = 0; break;
-	case 16: log2destBpp = 1; break;
-	case 32: log2destBpp = 2; break;
-	/* TODO: what about smaller than that? */
+#define NRULES (sizeof crTable / sizeof *crTable)
+#define NDEPTHS (6)
+
+/* Measure one case for every rule (or just the one named) and every pair of
+ * depths, each with the minimal colour map the depths require and with a full
+ * indexed one, and each with and without a halftone. In text format, each of
+ * those four variants is printed as a heat-map of MB/s. */
+static void sweep(size_t caseIndex, const char *onlyRule)
+{
+	static double result[NRULES][NDEPTHS][NDEPTHS];
+	report_record_t record;
+
+	sweeping = true;
+	testSize = SWEEPTESTSIZE;
+	benchSetTimeLimit(SWEEPTIMELIMIT);
+	init_alignment();
+	record.test = caseTable[caseIndex].string;
+
+	for (int variant = 0; variant < 4; variant++) {
+		bool indexed = variant & 1;
+		bool halftone = variant & 2;
+		for (size_t r = 0; r < NRULES; r++) {
+			for (uint32_t s = 0; s < NDEPTHS; s++) {
+				for (uint32_t d = 0; d < NDEPTHS; d++) {
+					result[r][s][d] = -1;
+					if (onlyRule != NULL && strcmp(onlyRule, crTable[r].string) != 0)
+						continue;
+					op.combinationRule = crTable[r].number;
+					op.noSource = ruleHasNoSource(op.combinationRule);
+					/* Without a source, there's nothing to map */
+					if (op.noSource && (s != d || indexed))
+						continue;
+					op.src.depth = 1u << s;
+					op.dest.depth = 1u << d;
+					if (configure(halftone, indexed ? (s <= 3 ? 1u << s : 15) : 0) != NULL)
+						continue;
+					/* Tallying needs a table to count into */
+					if ((op.combinationRule == CR_tallyIntoMap || op.combinationRule == CR_OLDtallyIntoMap) && !(op.cmFlags & ColorMapIndexedPart))
+						continue;
+
+					measurement_t m;
+					bench_stats_t stats;
+					m.index = caseIndex;
+					m.log2Bpp = d;
+					measure(&m, &stats);
+					result[r][s][d] = 1000.0 * m.byte_cnt / stats.median;
+
+					record.rule = crTable[r].string;
+					record.srcDepth = op.noSource ? 0 : op.src.depth;
+					record.destDepth = op.dest.depth;
+					record.colorMap = reportColorMap(op.cmFlags & ColorMapFixedPart, op.cmFlags & ColorMapIndexedPart, op.cmMask);
+					record.halftone = halftone;
+					record.median = result[r][s][d];
+					record.min = 1000.0 * m.byte_cnt / stats.min;
+					record.p95 = 1000.0 * m.byte_cnt / stats.p95;
+					record.mblits = m.blit_cnt > 0 ? 1000.0 * m.blit_cnt / stats.median : -1;
+					record.samples = stats.samples;
+					record.perPixel = counting ? m.perPixel : NULL;
+					reportRecord(&record);
+				}
+			}
+		}
+		if (format != REPORT_TEXT)
+			continue;
+
+		printf("\n%s, %s colour map, %s halftone (MB/s, source>destination depth)\n", caseTable[caseIndex].string, indexed ? "indexed" : "minimal", halftone ? "with" : "no");
+		printf("%-20s", "");
+		for (uint32_t s = 0; s < NDEPTHS; s++) {
+			for (uint32_t d = 0; d < NDEPTHS; d++) {
+				char heading[8];
+				snprintf(heading, sizeof heading, "%u>%u", 1u << s, 1u << d);
+				printf(" %6s", heading);
+			}
+		}
+		printf("\n");
+		for (size_t r = 0; r < NRULES; r++) {
+			if (onlyRule != NULL && strcmp(onlyRule, crTable[r].string) != 0)
+				continue;
+			printf("%-20s", crTable[r].string);
+			for (uint32_t s = 0; s < NDEPTHS; s++)
+				for (uint32_t d = 0; d < NDEPTHS; d++)
+					if (result[r][s][d] < 0)
+						printf(" %6s", "-");
+					else
+						printf(" %6.0f", result[r][s][d]);
+			printf("\n");
+		}
+		fflush(stdout);
 	}
+}
+
+void warning(const char *message)
+{
+    (void) message;
+//    fprintf(stderr, "warning: %s\n", message);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t iterations = 1;
+	bool scalarHalftone = false;
+	uint32_t map_width = 0;
+	bool reportKernel = false;
+	unsigned threads = 1;
+	bool batchMode = false;
+	int cpu = -1;
+	const char *sweepCase = NULL;
+
+	bool help = false;
+	int opt;
+	while ((opt = getopt_long(argc, argv, "hi:nsm:kj:bp:c:S:P", longOptions, NULL)) != -1) {
+		switch (opt) {
+		case '?': help = true; break;
+		case 'h': help = true; break;
+		case 'i': iterations = atoi(optarg); break;
+		case 'n': op.noSource = true; break;
+		case 's': scalarHalftone = true; break;
+		case 'm': map_width = atoi(optarg); break;
+		case 'k': reportKernel = true; break;
+		case 'j': threads = atoi(optarg); break;
+		case 'b': batchMode = true; break;
+		case 'p': cpu = atoi(optarg); break;
+		case 'c': benchSetConfidence(atof(optarg) / 100); break;
+		case 'S': sweepCase = optarg; break;
+		case 'P': counting = true; break;
+		}
+	}
+	if (help || (sweepCase == NULL && optind == argc) || (sweepCase != NULL && optind < argc - 1)) {
+bad_syntax:
+		fprintf(stderr, "Syntax: %s [-h] [-i iterations] [-n] [-s] [-m map width] [-k] [-j threads] [-b] [-p cpu] [-c confidence percent] [-P] [--csv|--json] combinationRule [srcDepth] destDepth\n", argv[0]);
+		fprintf(stderr, "        %s [-h] -S L1|L2|LLC|M|Tile|Tiny [-j threads] [-p cpu] [-c confidence percent] [-P] [--csv|--json] [combinationRule]\n", argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	if (counting && threads > 1) {
+		/* The counters only see the calling thread, so the band workers'
+		 * share of the work would silently go uncounted */
+		fprintf(stderr, "-P can't be combined with -j, because counters only cover the calling thread\n");
+		exit(EXIT_FAILURE);
+	}
+	size_t i;
+	const char *ruleName = optind < argc ? argv[optind] : NULL;
+	if (ruleName != NULL) {
+		for (i = 0; i < sizeof crTable / sizeof *crTable; i++) {
+			if (strcmp(ruleName, crTable[i].string) == 0) {
+				op.combinationRule = crTable[i].number;
+				break;
+			}
+		}
+		if (i == sizeof crTable / sizeof *crTable) {
+			fprintf(stderr, "Unrecognised combinationRule\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	const bench_cache_t *cache = benchCacheInfo();
+	dramBytes = cache->llc * 2 < MAXDRAMSIZE ? cache->llc * 2 : MAXDRAMSIZE;
+	surfaceBytes = SCREENHEIGHT * sizeof *src;
+	if (surfaceBytes < dramBytes)
+		surfaceBytes = dramBytes;
+	if (surfaceBytes < cache->llc / 2)
+		surfaceBytes = cache->llc / 2;
+	surfaceBytes = (surfaceBytes + sizeof *src - 1) / sizeof *src * sizeof *src;
+	if (!benchSurfaceCreate(&srcSurface, surfaceBytes, false) ||
+			!benchSurfaceCreate(&destSurface, surfaceBytes, true)) {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	src = srcSurface.bits;
+	dest = destSurface.bits;
+
+	/* First lookup table is non-uniform, suitable for 9-bit or wider maps with 16 or 32bpp */
+	memset(lookupTable, 0xAA, sizeof lookupTable);
+	lookupTable[0][1] = 0x55555555;
+
+	size_t sweepIndex = 0;
+	if (sweepCase != NULL) {
+		while (sweepIndex < NCASES && strcmp(sweepCase, caseTable[sweepIndex].string) != 0)
+			sweepIndex++;
+		if (sweepIndex == NCASES) {
+			fprintf(stderr, "Unrecognised case\n");
+			exit(EXIT_FAILURE);
+		}
+	} else {
+		if (ruleHasNoSource(op.combinationRule))
+			op.noSource = true;
+		if ((op.noSource && optind != argc - 2) || (!op.noSource && optind != argc - 3))
+			goto bad_syntax;
+		op.src.depth = atoi(argv[optind + 1]);
+		op.dest.depth = atoi(argv[argc - 1]);
+		if (op.src.depth < 1 || op.src.depth > 32 || (op.src.depth & (op.src.depth-1)) != 0 || op.dest.depth < 1 || op.dest.depth > 32 || (op.dest.depth & (op.dest.depth-1)) != 0) {
+			fprintf(stderr, "Bad colour depth\n");
+			exit(EXIT_FAILURE);
+		}
+
+		const char *error = configure(scalarHalftone, map_width);
+		if (error != NULL) {
+			fprintf(stderr, "%s\n", error);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	uint32_t log2destBpp = log2Depth(op.dest.depth);
+
+	if (cpu >= 0 && !benchPinCpu(cpu))
+		exit(EXIT_FAILURE);
 
 	initialiseCopyBits();
+#ifdef __x86_64__
+	addX64FastPaths();
+#endif
 	initialiseModule();
 
-	memset(src, 0x5A, sizeof src);
-	memset(dest, 0xA5, sizeof dest);
+	/* Informational lines mustn't corrupt machine-readable output */
+	FILE *info = format == REPORT_TEXT ? stdout : stderr;
+	report_record_t record;
+	record.rule = ruleName;
+	record.srcDepth = op.noSource ? 0 : op.src.depth;
+	record.destDepth = op.dest.depth;
+	record.colorMap = reportColorMap(op.cmFlags & ColorMapFixedPart, op.cmFlags & ColorMapIndexedPart, op.cmMask);
+	record.halftone = !op.noHalftone;
+
+	if (counting && !benchCountersOpen()) {
+		fprintf(info, "Performance counters unavailable, reporting time only\n");
+		counting = false;
+	}
+	fprintf(info, "Caches: L1 %zuK, L2 %zuK, LLC %zuK, line %zu bytes\n", cache->l1 / KILOBYTE, cache->l2 / KILOBYTE, cache->llc / KILOBYTE, cache->line);
 
-	printf("L1,     L2,     M\n");
+	if (threads > 1) {
+		threads = parallelCopyBitsInit(threads);
+		dispatch = copyBitsDispatchParallel;
+		fprintf(info, "Threads: %u\n", threads);
+	}
 
-	while (iterations--)
-	{
-		memcpy(dest, src, sizeof dest);
-
-		t1 = gettime();
-		bench_L(control, log2destBpp, false);
-		t2 = gettime();
-		byte_cnt = bench_L(plot, log2destBpp, false);
-		t3 = gettime();
-		printf("%6.2f, ", ((double)byte_cnt) / ((t3 - t2) - (t2 - t1)));
-		fflush(stdout);
+	memset(src, 0x5A, surfaceBytes);
+	memcpy(dest, src, surfaceBytes);
+	benchSurfaceSnapshot(&destSurface);
+
+	if (reportKernel && sweepCase == NULL) {
+#ifdef __x86_64__
+		const char *name, *isa;
+		if (x64DescribeFastPath(&op, &name, &isa))
+			fprintf(info, "Kernel: x64 %s (%s)\n", name, isa);
+		else
+			fprintf(info, "Kernel: no x86-64 fast path\n");
+#else
+		fprintf(info, "Kernel: not reported on this architecture\n");
+#endif
+	}
 
-		memcpy(dest, src, sizeof dest);
+	reportBegin(format, "bench");
 
-		t1 = gettime();
-		bench_L(control, log2destBpp, true);
-		t2 = gettime();
-		byte_cnt = bench_L(plot, log2destBpp, true);
-		t3 = gettime();
-		printf("%6.2f, ", ((double)byte_cnt) / ((t3 - t2) - (t2 - t1)));
-		fflush(stdout);
+	if (sweepCase != NULL) {
+		sweep(sweepIndex, ruleName);
+		reportEnd();
+		exit(EXIT_SUCCESS);
+	}
+
+	if (batchMode) {
+		/* Throughput of tiny blits, one call each versus one batch */
+		uint32_t batch_bytes = BYTES(BATCHREPEATS * BATCHSIZE * TINYWIDTH * TINYWIDTH, log2destBpp);
+		init_batch();
+		if (format == REPORT_TEXT)
+			printf("        Single, Batched (Mblits/s)\n");
+		while (iterations--)
+		{
+			bench_stats_t stats[2];
+			bool batched;
+			for (i = 0; i < 2; i++) {
+				batched = i;
+				benchMeasure(bench_batch, &batched, &stats[i]);
+				record.test = batched ? "Batched" : "Single";
+				record.median = 1000.0 * batch_bytes / stats[i].median;
+				record.min = 1000.0 * batch_bytes / stats[i].min;
+				record.p95 = 1000.0 * batch_bytes / stats[i].p95;
+				record.mblits = 1000.0 * BATCHREPEATS * BATCHSIZE / stats[i].median;
+				record.samples = stats[i].samples;
+				record.perPixel = NULL;
+				reportRecord(&record);
+			}
+			if (format == REPORT_TEXT) {
+				printf("Median, %6.2f, %6.2f\n", 1000.0 * BATCHREPEATS * BATCHSIZE / stats[0].median, 1000.0 * BATCHREPEATS * BATCHSIZE / stats[1].median);
+				printf("Min,    %6.2f, %6.2f\n", 1000.0 * BATCHREPEATS * BATCHSIZE / stats[0].min, 1000.0 * BATCHREPEATS * BATCHSIZE / stats[1].min);
+				printf("P95,    %6.2f, %6.2f\n", 1000.0 * BATCHREPEATS * BATCHSIZE / stats[0].p95, 1000.0 * BATCHREPEATS * BATCHSIZE / stats[1].p95);
+				fflush(stdout);
+			}
+		}
+		reportEnd();
+		exit(EXIT_SUCCESS);
+	}
+
+	init_alignment();
 
-		memcpy(dest, src, sizeof dest);
+	/* Rates are derived from the median, minimum and 95th percentile times.
+	 * Tile and Tiny are reported first in MB/s, then in Mblits/s. */
+	if (format == REPORT_TEXT)
+		printf("        L1,     L2,     LLC,    M,      Tile,   Tiny,   Tile,   Tiny\n");
 
-		t1 = gettime();
-		bench_M(control, log2destBpp);
-		t2 = gettime();
-		byte_cnt = bench_M(plot, log2destBpp);
-		t3 = gettime();
-		printf("%6.2f\n", ((double)byte_cnt) / ((t3 - t2) - (t2 - t1)));
+	while (iterations--)
+	{
+		measurement_t m[NCASES];
+		bench_stats_t stats[NCASES];
+		for (i = 0; i < NCASES; i++) {
+			m[i].index = i;
+			m[i].log2Bpp = log2destBpp;
+			measure(&m[i], &stats[i]);
+			record.test = caseTable[i].string;
+			record.median = 1000.0 * m[i].byte_cnt / stats[i].median;
+			record.min = 1000.0 * m[i].byte_cnt / stats[i].min;
+			record.p95 = 1000.0 * m[i].byte_cnt / stats[i].p95;
+			record.mblits = m[i].blit_cnt > 0 ? 1000.0 * m[i].blit_cnt / stats[i].median : -1;
+			record.samples = stats[i].samples;
+			record.perPixel = counting ? m[i].perPixel : NULL;
+			reportRecord(&record);
+		}
+		if (format != REPORT_TEXT)
+			continue;
+		for (int row = 0; row < 3; row++) {
+			static const char *label[3] = { "Median, ", "Min,    ", "P95,    " };
+			printf("%s", label[row]);
+			for (i = 0; i < NCASES; i++) {
+				double ns = row == 0 ? stats[i].median : row == 1 ? stats[i].min : stats[i].p95;
+				printf("%6.2f, ", 1000.0 * m[i].byte_cnt / ns);
+			}
+			for (i = 0; i < NCASES; i++) {
+				double ns = row == 0 ? stats[i].median : row == 1 ? stats[i].min : stats[i].p95;
+				if (m[i].blit_cnt > 0)
+					printf("%6.2f%s", 1000.0 * m[i].blit_cnt / ns, i == NCASES - 1 ? "\n" : ", ");
+			}
+		}
+		for (int counter = 0; counting && counter < BENCH_COUNTERS; counter++) {
+			printf("%s,%*s", benchCounterNames[counter], (int) (7 - strlen(benchCounterNames[counter])), "");
+			for (i = 0; i < NCASES; i++) {
+				if (m[i].perPixel[counter] < 0)
+					printf("%6s%s", "-", i == NCASES - 1 ? "\n" : ", ");
+				else
+					printf("%6.3f%s", m[i].perPixel[counter], i == NCASES - 1 ? "\n" : ", ");
+			}
+		}
 		fflush(stdout);
 	}
+	reportEnd();
 	exit(EXIT_SUCCESS);
 }
@@ -30,34 +30,55 @@
 #include <stdbool.h>
 
 #include <getopt.h>
-#include <sys/time.h>
 
 #include "BitBltDispatch.h"
+#include "BenchTiming.h"
+#include "BenchReport.h"
+#include "BenchCache.h"
+#include "BenchCounters.h"
+#include "BenchSurface.h"
 
 #define sqInt int
 
 extern sqInt initialiseModule(void);
 
-#define CACHELINELEN (32)
-#define L1CACHESIZE (16*1024)
-#define L2CACHESIZE (128*1024)
 #define KILOBYTE (1024)
 #define MEGABYTE (1024*1024)
 
-#define HALFL2CACHE (L2CACHESIZE/2 - 4*KILOBYTE)
+/* The memory test wants operands well beyond the last level cache, but
+ * there's no point going beyond this */
+#define MAXDRAMSIZE (256*MEGABYTE)
+
 #define TESTSIZE (40*MEGABYTE)
 
 #define SCREENWIDTH (1920)
 #define SCREENHEIGHT (1080)
 #define TILEWIDTH (32)
 #define TINYWIDTH (8)
+#define TILEHEIGHT (32)
+#define TINYHEIGHT (16)
+#define ALIGNMENTS (256)
+
+/* At least a screen's worth, but big enough for the memory test. Comparing
+ * colours never writes to either operand, so neither needs restoring. */
+static bench_surface_t srcASurface;
+static bench_surface_t srcBSurface;
+static uint32_t (*srcA)[SCREENWIDTH];
+static uint32_t (*srcB)[SCREENWIDTH];
+static size_t surfaceBytes;
+static size_t dramBytes;
 
-static uint32_t srcA[SCREENHEIGHT][SCREENWIDTH];
-static uint32_t srcB[SCREENHEIGHT][SCREENWIDTH];
-static uint32_t elsewhere[SCREENHEIGHT][SCREENWIDTH];
+static uint8_t alignment[ALIGNMENTS];
 
 static compare_operation_t op;
 
+static int format = REPORT_TEXT;
+static const struct option longOptions[] = {
+	{ "csv",  no_argument, &format, REPORT_CSV  },
+	{ "json", no_argument, &format, REPORT_JSON },
+	{ NULL,   0,           NULL,    0           },
+};
+
 static const struct {
 	const char *string;
 	match_rule_t number;
@@ -93,31 +114,30 @@ static void compare(size_t A_x, size_t A_y, size_t B_x, size_t B_y, size_t w, si
 	(void) compareColorsDispatch(&op);
 }
 
-static uint64_t gettime(void)
-{
-	struct timeval tv;
-
-	gettimeofday (&tv, NULL);
-	return tv.tv_sec * 1000000 + tv.tv_usec;
-}
-
-static uint32_t bench_L(void (*test)(), uint32_t log2BppA, uint32_t log2BppB, bool l2)
+static uint32_t bench_L(void (*test)(), uint32_t log2BppA, uint32_t log2BppB, size_t cacheSize)
 {
+	/* Size the operands to fill about half of the cache between them,
+	 * leaving a little room for everything else */
     uint32_t combinedBpp = (1 << log2BppA) + (1 << log2BppB);
-	uint32_t width = l2 ? SCREENWIDTH - 64 : SCREENWIDTH / 2;
-	uint32_t height = l2 ? HALFL2CACHE / (SCREENWIDTH * combinedBpp) : 1;
+	size_t slack = cacheSize / 8 < 4*KILOBYTE ? cacheSize / 8 : 4*KILOBYTE;
+	size_t pixels = (cacheSize / 2 - slack) / combinedBpp;
+	uint32_t width = pixels < SCREENWIDTH - 64 ? pixels : SCREENWIDTH - 64;
+	uint32_t height = pixels < SCREENWIDTH ? 1 : pixels / SCREENWIDTH;
 	uint32_t times = TESTSIZE / (width * height * combinedBpp);
-    uint32_t wordsA = (l2 ? (SCREENWIDTH * height) : width) >> (2 - log2BppA);
-    uint32_t wordsB = (l2 ? (SCREENWIDTH * height) : width) >> (2 - log2BppB);
+    uint32_t wordsA = (height > 1 ? (SCREENWIDTH * height) : width) >> (2 - log2BppA);
+    uint32_t wordsB = (height > 1 ? (SCREENWIDTH * height) : width) >> (2 - log2BppB);
+	uint32_t stride = benchCacheInfo()->line / sizeof **srcA;
 	int i, j, x = 0, q = 0;
 	volatile int qx;
-	for (i = times; i >= 0; i--)
+	if (times == 0)
+		times = 1;
+	for (i = times; i > 0; i--)
 	{
-		/* Ensure the buffers are in the L1/L2 cache as appropriate */
-		for (j = 0; (unsigned) j < wordsA; j += CACHELINELEN / sizeof **srcA)
+		/* Ensure the buffers are in the cache being tested */
+		for (j = 0; (unsigned) j < wordsA; j += stride)
 			q += srcA[0][j];
 		q += srcA[0][wordsA-1];
-        for (j = 0; (unsigned) j < wordsB; j += CACHELINELEN / sizeof **srcB)
+        for (j = 0; (unsigned) j < wordsB; j += stride)
             q += srcB[0][j];
         q += srcB[0][wordsB-1];
 
@@ -133,10 +153,12 @@ static uint32_t bench_M(void (*test)(), uint32_t log2BppA, uint32_t log2BppB)
 {
     uint32_t combinedBpp = (1 << log2BppA) + (1 << log2BppB);
 	uint32_t width = SCREENWIDTH - 64;
-	uint32_t height = SCREENHEIGHT;
+	uint32_t height = dramBytes / (SCREENWIDTH << (log2BppA > log2BppB ? log2BppA : log2BppB));
 	uint32_t times = TESTSIZE / (width * height * combinedBpp);
 	int i, x = 0;
-	for (i = times; i >= 0; i--)
+	if (times == 0)
+		times = 1;
+	for (i = times; i > 0; i--)
 	{
 		x = (x + 1) & 63;
 		test(x, 0, 63 - x, 0, width, height);
@@ -144,6 +166,130 @@ static uint32_t bench_M(void (*test)(), uint32_t log2BppA, uint32_t log2BppB)
 	return width * height * times * combinedBpp;
 }
 
+static void init_alignment(void)
+{
+	/* Icons and glyphs land at arbitrary x positions, so vary the alignment
+	 * of each operand independently without paying for rand() in the timed
+	 * loop */
+	srand(1);
+	for (size_t i = 0; i < ALIGNMENTS; i++)
+		alignment[i] = rand() & 63;
+}
+
+static uint32_t bench_S(void (*test)(), uint32_t log2BppA, uint32_t log2BppB, uint32_t width, uint32_t height, uint32_t *blit_cnt)
+{
+	uint32_t combinedBpp = (1 << log2BppA) + (1 << log2BppB);
+	uint32_t times = TESTSIZE / (width * height * combinedBpp);
+	int i;
+	if (times == 0)
+		times = 1;
+	for (i = times; i > 0; i--)
+		test(alignment[i % ALIGNMENTS], 0, alignment[(i + 1) % ALIGNMENTS], 0, width, height);
+	*blit_cnt = times;
+	return width * height * times * combinedBpp;
+}
+
+static uint32_t case_L1(void (*test)(), uint32_t log2BppA, uint32_t log2BppB, uint32_t *blit_cnt)
+{
+	*blit_cnt = 0;
+	return bench_L(test, log2BppA, log2BppB, benchCacheInfo()->l1);
+}
+
+static uint32_t case_L2(void (*test)(), uint32_t log2BppA, uint32_t log2BppB, uint32_t *blit_cnt)
+{
+	*blit_cnt = 0;
+	return bench_L(test, log2BppA, log2BppB, benchCacheInfo()->l2);
+}
+
+static uint32_t case_LLC(void (*test)(), uint32_t log2BppA, uint32_t log2BppB, uint32_t *blit_cnt)
+{
+	*blit_cnt = 0;
+	return bench_L(test, log2BppA, log2BppB, benchCacheInfo()->llc);
+}
+
+static uint32_t case_M(void (*test)(), uint32_t log2BppA, uint32_t log2BppB, uint32_t *blit_cnt)
+{
+	*blit_cnt = 0;
+	return bench_M(test, log2BppA, log2BppB);
+}
+
+static uint32_t case_tile(void (*test)(), uint32_t log2BppA, uint32_t log2BppB, uint32_t *blit_cnt)
+{
+	return bench_S(test, log2BppA, log2BppB, TILEWIDTH, TILEHEIGHT, blit_cnt);
+}
+
+static uint32_t case_tiny(void (*test)(), uint32_t log2BppA, uint32_t log2BppB, uint32_t *blit_cnt)
+{
+	return bench_S(test, log2BppA, log2BppB, TINYWIDTH, TINYHEIGHT, blit_cnt);
+}
+
+static const struct {
+	const char *string;
+	uint32_t (*run)(void (*test)(), uint32_t log2BppA, uint32_t log2BppB, uint32_t *blit_cnt);
+} caseTable[] = {
+	{ "L1",   case_L1,   },
+	{ "L2",   case_L2,   },
+	{ "LLC",  case_LLC,  },
+	{ "M",    case_M,    },
+	{ "Tile", case_tile, },
+	{ "Tiny", case_tiny, },
+};
+
+#define NCASES (sizeof caseTable / sizeof *caseTable)
+
+typedef struct {
+	size_t index;
+	void (*test)();
+	uint32_t log2BppA;
+	uint32_t log2BppB;
+	uint32_t byte_cnt;
+	uint32_t blit_cnt;
+	double perPixel[BENCH_COUNTERS];
+} measurement_t;
+
+static bool counting;
+
+static void run_case(void *arg)
+{
+	measurement_t *m = arg;
+	m->byte_cnt = caseTable[m->index].run(m->test, m->log2BppA, m->log2BppB, &m->blit_cnt);
+}
+
+static void measure(measurement_t *m, bench_stats_t *stats)
+{
+	bench_stats_t overheads;
+
+	m->test = control;
+	benchMeasure(run_case, m, &overheads);
+	m->test = compare;
+	benchMeasure(run_case, m, stats);
+	benchSubtractControl(stats, &overheads);
+	if (!stats->converged)
+		fprintf(stderr, "warning: %s did not converge after %u samples\n", caseTable[m->index].string, stats->samples);
+
+	if (counting) {
+		/* One more run of each, counted rather than timed */
+		double overheadCounts[BENCH_COUNTERS];
+		m->test = control;
+		benchCountersStart();
+		run_case(m);
+		benchCountersStop(overheadCounts);
+		m->test = compare;
+		benchCountersStart();
+		run_case(m);
+		benchCountersStop(m->perPixel);
+		double pixels = (double) m->byte_cnt / ((1 << m->log2BppA) + (1 << m->log2BppB));
+		for (int i = 0; i < BENCH_COUNTERS; i++) {
+			if (m->perPixel[i] < 0 || overheadCounts[i] < 0)
+				m->perPixel[i] = -1;
+			else if (m->perPixel[i] < overheadCounts[i])
+				m->perPixel[i] = 0;
+			else
+				m->perPixel[i] = (m->perPixel[i] - overheadCounts[i]) / pixels;
+		}
+	}
+}
+
 void warning(const char *message)
 {
     (void) message;
@@ -152,23 +298,26 @@ void warning(const char *message)
 
 int main(int argc, char *argv[])
 {
-	uint64_t t1, t2, t3;
-	uint32_t byte_cnt;
 	size_t iterations = 1;
+	int cpu = -1;
 
 	op.tally = 1;
 
 	bool help = false;
 	int opt;
-	while ((opt = getopt(argc, argv, "hi:t:")) != -1) {
+	while ((opt = getopt_long(argc, argv, "hi:t:p:c:P", longOptions, NULL)) != -1) {
 		switch (opt) {
+		case '?': help = true; break;
 		case 'h': help = true; break;
 		case 'i': iterations = atoi(optarg); break;
         case 't': op.tally = atoi(optarg); break;
+		case 'p': cpu = atoi(optarg); break;
+		case 'c': benchSetConfidence(atof(optarg) / 100); break;
+		case 'P': counting = true; break;
 		}
 	}
 	if (help || optind != argc - 3) {
-		fprintf(stderr, "Syntax: %s [-h] [-i iterations] [-t tallyFlag] matchRule depthA depthB\n", argv[0]);
+		fprintf(stderr, "Syntax: %s [-h] [-i iterations] [-t tallyFlag] [-p cpu] [-c confidence percent] [-P] [--csv|--json] matchRule depthA depthB\n", argv[0]);
 		exit(EXIT_FAILURE);
 	}
 	size_t i;
@@ -192,6 +341,22 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	const bench_cache_t *cache = benchCacheInfo();
+	dramBytes = cache->llc * 2 < MAXDRAMSIZE ? cache->llc * 2 : MAXDRAMSIZE;
+	surfaceBytes = SCREENHEIGHT * sizeof *srcA;
+	if (surfaceBytes < dramBytes)
+		surfaceBytes = dramBytes;
+	if (surfaceBytes < cache->llc / 2)
+		surfaceBytes = cache->llc / 2;
+	surfaceBytes = (surfaceBytes + sizeof *srcA - 1) / sizeof *srcA * sizeof *srcA;
+	if (!benchSurfaceCreate(&srcASurface, surfaceBytes, false) ||
+			!benchSurfaceCreate(&srcBSurface, surfaceBytes, false)) {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	srcA = srcASurface.bits;
+	srcB = srcBSurface.bits;
+
 	op.srcA.bits = srcA;
 	op.srcA.pitch = (SCREENWIDTH * op.srcA.depth / 8 + 3) &~ 3;
 	op.srcA.msb = 1;
@@ -215,46 +380,80 @@ int main(int argc, char *argv[])
     /* TODO: what about smaller than that? */
     }
 
+	if (cpu >= 0 && !benchPinCpu(cpu))
+		exit(EXIT_FAILURE);
+
 	initialiseCopyBits();
 	initialiseModule();
 
-	memset(srcA, 0, sizeof srcA);
-	memset(srcB, 0, sizeof srcB);
-    memset(elsewhere, 0, sizeof elsewhere);
+	memset(srcA, 0, surfaceBytes);
+	memset(srcB, 0, surfaceBytes);
 
-	printf("L1,     L2,     M\n");
-
-	while (iterations--)
-	{
-        memcpy(srcA, elsewhere, sizeof elsewhere);
-
-		t1 = gettime();
-		bench_L(control, log2srcABpp, log2srcBBpp, false);
-		t2 = gettime();
-		byte_cnt = bench_L(compare, log2srcABpp, log2srcBBpp, false);
-		t3 = gettime();
-		printf("%6.2f, ", ((double)byte_cnt) / ((t3 - t2) - (t2 - t1)));
-		fflush(stdout);
+	init_alignment();
 
-        memcpy(srcA, elsewhere, sizeof elsewhere);
-
-		t1 = gettime();
-		bench_L(control, log2srcABpp, log2srcBBpp, true);
-		t2 = gettime();
-		byte_cnt = bench_L(compare, log2srcABpp, log2srcBBpp, true);
-		t3 = gettime();
-		printf("%6.2f, ", ((double)byte_cnt) / ((t3 - t2) - (t2 - t1)));
-		fflush(stdout);
+	report_record_t record;
+	record.rule = argv[optind];
+	record.srcDepth = op.srcA.depth;
+	record.destDepth = op.srcB.depth;
+	record.colorMap = "none";
+	record.halftone = false;
+	if (counting && !benchCountersOpen()) {
+		fprintf(format == REPORT_TEXT ? stdout : stderr, "Performance counters unavailable, reporting time only\n");
+		counting = false;
+	}
+	if (format == REPORT_TEXT)
+		printf("Caches: L1 %zuK, L2 %zuK, LLC %zuK, line %zu bytes\n", cache->l1 / KILOBYTE, cache->l2 / KILOBYTE, cache->llc / KILOBYTE, cache->line);
+	reportBegin(format, "bench2");
 
-        memcpy(srcA, elsewhere, sizeof elsewhere);
+	/* Rates are derived from the median, minimum and 95th percentile times.
+	 * Tile and Tiny are reported first in MB/s, then in Mblits/s. */
+	if (format == REPORT_TEXT)
+		printf("        L1,     L2,     LLC,    M,      Tile,   Tiny,   Tile,   Tiny\n");
 
-		t1 = gettime();
-		bench_M(control, log2srcABpp, log2srcBBpp);
-		t2 = gettime();
-		byte_cnt = bench_M(compare, log2srcABpp, log2srcBBpp);
-		t3 = gettime();
-		printf("%6.2f\n", ((double)byte_cnt) / ((t3 - t2) - (t2 - t1)));
+	while (iterations--)
+	{
+		measurement_t m[NCASES];
+		bench_stats_t stats[NCASES];
+		for (i = 0; i < NCASES; i++) {
+			m[i].index = i;
+			m[i].log2BppA = log2srcABpp;
+			m[i].log2BppB = log2srcBBpp;
+			measure(&m[i], &stats[i]);
+			record.test = caseTable[i].string;
+			record.median = 1000.0 * m[i].byte_cnt / stats[i].median;
+			record.min = 1000.0 * m[i].byte_cnt / stats[i].min;
+			record.p95 = 1000.0 * m[i].byte_cnt / stats[i].p95;
+			record.mblits = m[i].blit_cnt > 0 ? 1000.0 * m[i].blit_cnt / stats[i].median : -1;
+			record.samples = stats[i].samples;
+			record.perPixel = counting ? m[i].perPixel : NULL;
+			reportRecord(&record);
+		}
+		if (format != REPORT_TEXT)
+			continue;
+		for (int row = 0; row < 3; row++) {
+			static const char *label[3] = { "Median, ", "Min,    ", "P95,    " };
+			printf("%s", label[row]);
+			for (i = 0; i < NCASES; i++) {
+				double ns = row == 0 ? stats[i].median : row == 1 ? stats[i].min : stats[i].p95;
+				printf("%6.2f, ", 1000.0 * m[i].byte_cnt / ns);
+			}
+			for (i = 0; i < NCASES; i++) {
+				double ns = row == 0 ? stats[i].median : row == 1 ? stats[i].min : stats[i].p95;
+				if (m[i].blit_cnt > 0)
+					printf("%6.2f%s", 1000.0 * m[i].blit_cnt / ns, i == NCASES - 1 ? "\n" : ", ");
+			}
+		}
+		for (int counter = 0; counting && counter < BENCH_COUNTERS; counter++) {
+			printf("%s,%*s", benchCounterNames[counter], (int) (7 - strlen(benchCounterNames[counter])), "");
+			for (i = 0; i < NCASES; i++) {
+				if (m[i].perPixel[counter] < 0)
+					printf("%6s%s", "-", i == NCASES - 1 ? "\n" : ", ");
+				else
+					printf("%6.3f%s", m[i].perPixel[counter], i == NCASES - 1 ? "\n" : ", ");
+			}
+		}
 		fflush(stdout);
 	}
+	reportEnd();
 	exit(EXIT_SUCCESS);
 }
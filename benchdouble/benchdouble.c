@@ -26,10 +26,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
 
-#include <sys/time.h>
+#include <getopt.h>
 
 #include "PixelDouble.h"
+#include "BenchTiming.h"
+#include "BenchReport.h"
 
 #define WIDTH  480
 #define HEIGHT 360
@@ -41,6 +44,13 @@ static uint32_t *src;
 static uint32_t *dst;
 static uint32_t *dst2;
 
+static int format = REPORT_TEXT;
+static const struct option longOptions[] = {
+	{ "csv",  no_argument, &format, REPORT_CSV  },
+	{ "json", no_argument, &format, REPORT_JSON },
+	{ NULL,   0,           NULL,    0           },
+};
+
 void PixelDouble16_480_360(uint16_t *dst, const uint16_t *src)
 {
     for (int y = HEIGHT - 1; y >= 0; y--)
@@ -56,25 +66,55 @@ void PixelDouble16_480_360(uint16_t *dst, const uint16_t *src)
     }
 }
 
-static uint64_t gettime(void)
-{
-	struct timeval tv;
-
-	gettimeofday (&tv, NULL);
-	return tv.tv_sec * 1000000 + tv.tv_usec;
-}
-
 extern void armSimdPixelDouble16_32_16_wide(uint32_t width, uint32_t height, uint32_t *dst, uint32_t dstStride, const uint32_t *src, uint32_t srcStride);
 #define PixelDouble16(dst, src) armSimdPixelDouble16_32_16_wide(WIDTH, HEIGHT, dst, WIDTH, src, 0)
 extern void armSimdPixelDouble16_32_32_wide(uint32_t width, uint32_t height, uint32_t *dst, uint32_t dstStride, const uint32_t *src, uint32_t srcStride);
 #define PixelDouble32(dst, src) armSimdPixelDouble16_32_32_wide(WIDTH * 2, HEIGHT, dst, WIDTH * 2, src, 0)
 
+#define TIMES 100
+
+static void run(void *arg)
+{
+	(void) arg;
+	for (uint32_t loop = TIMES; loop > 0; loop--)
+#if 0
+#if BPP == 16
+		PixelDouble16_480_360((uint16_t *) dst, (uint16_t *) src);
+#else
+		PixelDouble32_480_360(dst, src);
+#endif
+#else
+#if BPP == 16
+		PixelDouble16(dst, src);
+#else
+		PixelDouble32(dst, src);
+#endif
+#endif
+}
+
 int main(int argc, char *argv[])
 {
-	uint64_t t1, t2;
-	size_t iterations = 25;
-	(void) argc;
-	(void) argv;
+	size_t iterations = 1;
+	int cpu = -1;
+
+	bool help = false;
+	int opt;
+	while ((opt = getopt_long(argc, argv, "hi:p:c:", longOptions, NULL)) != -1) {
+		switch (opt) {
+		case '?': help = true; break;
+		case 'h': help = true; break;
+		case 'i': iterations = atoi(optarg); break;
+		case 'p': cpu = atoi(optarg); break;
+		case 'c': benchSetConfidence(atof(optarg) / 100); break;
+		}
+	}
+	if (help || optind != argc) {
+		fprintf(stderr, "Syntax: %s [-h] [-i iterations] [-p cpu] [-c confidence percent] [--csv|--json]\n", argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	if (cpu >= 0 && !benchPinCpu(cpu))
+		exit(EXIT_FAILURE);
+
 	src = (uint32_t *)(((uintptr_t) buffer + CACHELINE_LEN - 1) &~ (CACHELINE_LEN - 1));
 //	src++;
 	dst = src + WIDTH * HEIGHT;
@@ -97,27 +137,33 @@ int main(int argc, char *argv[])
 #endif
 #endif
 
+	report_record_t record;
+	record.rule = "pixelDouble";
+	record.srcDepth = BPP;
+	record.destDepth = BPP;
+	record.colorMap = "none";
+	record.halftone = false;
+	record.test = "480x360";
+	record.mblits = -1;
+	record.perPixel = NULL;
+	reportBegin(format, "benchdouble");
+
+	if (format == REPORT_TEXT)
+		printf("Median, Min,    P95\n");
 	while (iterations--)
 	{
-		t1 = gettime();
-#define TIMES 100
-		for (uint32_t loop = TIMES; loop > 0; loop--)
-#if 0
-#if BPP == 16
-            PixelDouble16_480_360((uint16_t *) dst, (uint16_t *) src);
-#else
-            PixelDouble32_480_360(dst, src);
-#endif
-#else
-#if BPP == 16
-            PixelDouble16(dst, src);
-#else
-		    PixelDouble32(dst, src);
-#endif
-#endif
-		t2 = gettime();
-		printf("%6.2f\n", ((double)5*WIDTH*HEIGHT*TIMES) / (t2 - t1));
-		fflush(stdout);
+		bench_stats_t stats;
+		benchMeasure(run, NULL, &stats);
+		record.median = 5000.0*WIDTH*HEIGHT*TIMES / stats.median;
+		record.min = 5000.0*WIDTH*HEIGHT*TIMES / stats.min;
+		record.p95 = 5000.0*WIDTH*HEIGHT*TIMES / stats.p95;
+		record.samples = stats.samples;
+		reportRecord(&record);
+		if (format == REPORT_TEXT) {
+			printf("%6.2f, %6.2f, %6.2f\n", record.median, record.min, record.p95);
+			fflush(stdout);
+		}
 	}
+	reportEnd();
 	exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <unistd.h>
+
+#include "BenchCache.h"
+
+static bench_cache_t cache;
+static bool discovered;
+
+static size_t fromSysconf(int name)
+{
+	long value = sysconf(name);
+	return value > 0 ? (size_t) value : 0;
+}
+
+static bool readSysfs(unsigned index, const char *attribute, char *buffer, size_t size)
+{
+	char path[80];
+	snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu0/cache/index%u/%s", index, attribute);
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		return false;
+	bool ok = fgets(buffer, size, f) != NULL;
+	fclose(f);
+	buffer[strcspn(buffer, "\n")] = '\0';
+	return ok;
+}
+
+static size_t parseSize(const char *s)
+{
+	char *end;
+	size_t value = strtoul(s, &end, 10);
+	if (*end == 'K')
+		value *= 1024;
+	else if (*end == 'M')
+		value *= 1024*1024;
+	return value;
+}
+
+static void fromSysfs(void)
+{
+	/* Each index describes one cache; skip the instruction caches */
+	char buffer[32];
+	for (unsigned index = 0; readSysfs(index, "level", buffer, sizeof buffer); index++) {
+		unsigned level = atoi(buffer);
+		if (!readSysfs(index, "type", buffer, sizeof buffer) || strcmp(buffer, "Instruction") == 0)
+			continue;
+		if (!readSysfs(index, "size", buffer, sizeof buffer))
+			continue;
+		size_t size = parseSize(buffer);
+		if (level == 1 && cache.l1 == 0)
+			cache.l1 = size;
+		else if (level == 2 && cache.l2 == 0)
+			cache.l2 = size;
+		else if (level >= 3 && size > cache.llc)
+			cache.llc = size;
+		if (cache.line == 0 && readSysfs(index, "coherency_line_size", buffer, sizeof buffer))
+			cache.line = parseSize(buffer);
+	}
+}
+
+const bench_cache_t *benchCacheInfo(void)
+{
+	if (discovered)
+		return &cache;
+	discovered = true;
+
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+	cache.line = fromSysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+	cache.l1 = fromSysconf(_SC_LEVEL1_DCACHE_SIZE);
+	cache.l2 = fromSysconf(_SC_LEVEL2_CACHE_SIZE);
+	cache.llc = fromSysconf(_SC_LEVEL3_CACHE_SIZE);
+	if (cache.llc == 0)
+		cache.llc = fromSysconf(_SC_LEVEL4_CACHE_SIZE);
+#endif
+	/* Not all C libraries know the answers (glibc doesn't on ARM), so fill
+	 * in any gaps from sysfs */
+	if (cache.line == 0 || cache.l1 == 0 || cache.l2 == 0 || cache.llc == 0)
+		fromSysfs();
+
+	if (cache.line == 0)
+		cache.line = BENCH_DEFAULT_LINE;
+	if (cache.l1 == 0)
+		cache.l1 = BENCH_DEFAULT_L1;
+	if (cache.l2 == 0)
+		cache.l2 = BENCH_DEFAULT_L2;
+	if (cache.llc < cache.l2)
+		cache.llc = cache.l2;
+	return &cache;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BENCHCACHE_H_
+#define BENCHCACHE_H_
+
+#include <stddef.h>
+
+/* Used for anything the host won't tell us (these match the ARM11 that the
+ * benchmarks were originally written for) */
+#define BENCH_DEFAULT_LINE (32)
+#define BENCH_DEFAULT_L1   (16*1024)
+#define BENCH_DEFAULT_L2   (128*1024)
+
+/* Sizes in bytes of the data caches seen by the current CPU. If there's no
+ * third level, llc is the same as l2. */
+typedef struct {
+	size_t line;
+	size_t l1;
+	size_t l2;
+	size_t llc;
+} bench_cache_t;
+
+/* Discover the cache hierarchy via sysconf(), falling back to sysfs and then
+ * to the defaults above. The result is cached after the first call. */
+const bench_cache_t *benchCacheInfo(void);
+
+#endif /* BENCHCACHE_H_ */
@@ -0,0 +1,137 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "BenchCounters.h"
+
+const char *const benchCounterNames[BENCH_COUNTERS] = {
+	"Cyc/px",
+	"Ins/px",
+	"L1D/px",
+	"LLC/px",
+	"BrM/px",
+};
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} events[BENCH_COUNTERS] = {
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+static int leader = -1;
+/* Position of each counter in the group's read buffer, or -1 */
+static int slot[BENCH_COUNTERS];
+static int members;
+
+static int openEvent(bench_counter_t counter, int group)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof attr);
+	attr.size = sizeof attr;
+	attr.type = events[counter].type;
+	attr.config = events[counter].config;
+	attr.disabled = group == -1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+bool benchCountersOpen(void)
+{
+	leader = openEvent(COUNTER_CYCLES, -1);
+	if (leader < 0)
+		return false;
+	slot[COUNTER_CYCLES] = 0;
+	members = 1;
+	for (int i = COUNTER_CYCLES + 1; i < BENCH_COUNTERS; i++) {
+		if (openEvent(i, leader) >= 0)
+			slot[i] = members++;
+		else
+			slot[i] = -1;
+	}
+	return true;
+}
+
+void benchCountersStart(void)
+{
+	ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void benchCountersStop(double counts[BENCH_COUNTERS])
+{
+	struct {
+		uint64_t nr;
+		uint64_t timeEnabled;
+		uint64_t timeRunning;
+		uint64_t value[BENCH_COUNTERS];
+	} buffer;
+
+	ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	if (read(leader, &buffer, sizeof buffer) < (ssize_t) (3 + members) * (ssize_t) sizeof (uint64_t) || buffer.timeRunning == 0) {
+		for (int i = 0; i < BENCH_COUNTERS; i++)
+			counts[i] = -1;
+		return;
+	}
+	double scale = (double) buffer.timeEnabled / buffer.timeRunning;
+	for (int i = 0; i < BENCH_COUNTERS; i++)
+		counts[i] = slot[i] < 0 ? -1 : buffer.value[slot[i]] * scale;
+}
+
+#else
+
+bool benchCountersOpen(void)
+{
+	return false;
+}
+
+void benchCountersStart(void)
+{
+}
+
+void benchCountersStop(double counts[BENCH_COUNTERS])
+{
+	for (int i = 0; i < BENCH_COUNTERS; i++)
+		counts[i] = -1;
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BENCHCOUNTERS_H_
+#define BENCHCOUNTERS_H_
+
+#include <stdbool.h>
+
+typedef enum {
+	COUNTER_CYCLES,
+	COUNTER_INSTRUCTIONS,
+	COUNTER_L1D_MISSES,
+	COUNTER_LLC_MISSES,
+	COUNTER_BRANCH_MISSES,
+	BENCH_COUNTERS
+} bench_counter_t;
+
+/* Short names, suitable for column headings */
+extern const char *const benchCounterNames[BENCH_COUNTERS];
+
+/* Open the hardware performance counters for this thread. Returns false if
+ * not even the cycle counter is available (no perf_event_open, or
+ * perf_event_paranoid forbids it), in which case the harnesses fall back to
+ * reporting time only. Individual counters the PMU lacks are left out. */
+bool benchCountersOpen(void);
+
+/* Count events between these calls. Each element of counts is set to the
+ * number of events (scaled up if the counters were multiplexed), or to a
+ * negative value if that counter isn't available. */
+void benchCountersStart(void);
+void benchCountersStop(double counts[BENCH_COUNTERS]);
+
+#endif /* BENCHCOUNTERS_H_ */
@@ -0,0 +1,264 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "BenchCrc.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+/* The polynomial, bit-reversed */
+#define POLY (0xEDB88320)
+
+static uint32_t table[16][256];
+static uint32_t (*update)(uint32_t reg, const uint8_t *p, size_t len);
+static const char *implementation;
+
+static inline uint32_t load32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint32_t updateBytes(uint32_t reg, const uint8_t *p, size_t len)
+{
+	while (len-- > 0)
+		reg = (reg >> 8) ^ table[0][(reg ^ *p++) & 0xFF];
+	return reg;
+}
+
+static uint32_t updateSlicing16(uint32_t reg, const uint8_t *p, size_t len)
+{
+	for (; len >= 16; p += 16, len -= 16) {
+		uint32_t a = reg ^ load32(p);
+		uint32_t b = load32(p + 4);
+		uint32_t c = load32(p + 8);
+		uint32_t d = load32(p + 12);
+		reg = table[15][a & 0xFF] ^ table[14][a >> 8 & 0xFF] ^
+		      table[13][a >> 16 & 0xFF] ^ table[12][a >> 24] ^
+		      table[11][b & 0xFF] ^ table[10][b >> 8 & 0xFF] ^
+		      table[9][b >> 16 & 0xFF] ^ table[8][b >> 24] ^
+		      table[7][c & 0xFF] ^ table[6][c >> 8 & 0xFF] ^
+		      table[5][c >> 16 & 0xFF] ^ table[4][c >> 24] ^
+		      table[3][d & 0xFF] ^ table[2][d >> 8 & 0xFF] ^
+		      table[1][d >> 16 & 0xFF] ^ table[0][d >> 24];
+	}
+	return updateBytes(reg, p, len);
+}
+
+#if defined(__x86_64__)
+
+/* Fold 64 bytes at a time with carry-less multiplies, then reduce to 32
+ * bits with Barrett reduction, as in Intel's paper "Fast CRC Computation
+ * for Generic Polynomials Using PCLMULQDQ Instruction". The constants are
+ * the bit-reflected ones given there for this polynomial. */
+__attribute__((target("pclmul")))
+static uint32_t updatePclmul(uint32_t reg, const uint8_t *p, size_t len)
+{
+	if (len < 64)
+		return updateSlicing16(reg, p, len);
+
+	const __m128i k1k2 = _mm_set_epi64x(0x01C6E41596, 0x0154442BD4);
+	const __m128i k3k4 = _mm_set_epi64x(0x00CCAA009E, 0x01751997D0);
+	const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163CD6124);
+	const __m128i poly = _mm_set_epi64x(0x01F7011641, 0x01DB710641);
+	const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+	__m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) p), _mm_cvtsi32_si128(reg));
+	x2 = _mm_loadu_si128((const __m128i *) (p + 16));
+	x3 = _mm_loadu_si128((const __m128i *) (p + 32));
+	x4 = _mm_loadu_si128((const __m128i *) (p + 48));
+	p += 64;
+	len -= 64;
+
+	/* Four lanes of 16 bytes in parallel */
+	for (; len >= 64; p += 64, len -= 64) {
+		x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *) p));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *) (p + 16)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *) (p + 32)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *) (p + 48)));
+	}
+
+	/* Fold the lanes into one */
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	/* Then any remaining whole 16 byte blocks */
+	for (; len >= 16; p += 16, len -= 16) {
+		x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *) p)), x5);
+	}
+
+	/* 128 bits down to 64 */
+	x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, low32);
+	x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	/* Barrett reduction to 32 */
+	x2 = _mm_and_si128(x1, low32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+	x2 = _mm_and_si128(x2, low32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	reg = _mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+
+	return updateBytes(reg, p, len);
+}
+
+#elif defined(__aarch64__)
+
+/* The assembler directive enables the instructions without needing the
+ * whole file to be built for a CPU that has them */
+static inline uint32_t crc32b(uint32_t reg, uint8_t v)
+{
+	__asm__(".arch_extension crc\n\tcrc32b %w0, %w0, %w1" : "+r" (reg) : "r" (v));
+	return reg;
+}
+
+static inline uint32_t crc32x(uint32_t reg, uint64_t v)
+{
+	__asm__(".arch_extension crc\n\tcrc32x %w0, %w0, %x1" : "+r" (reg) : "r" (v));
+	return reg;
+}
+
+static uint32_t updateArmv8(uint32_t reg, const uint8_t *p, size_t len)
+{
+	for (; len > 0 && ((uintptr_t) p & 7) != 0; len--)
+		reg = crc32b(reg, *p++);
+	for (; len >= 8; p += 8, len -= 8) {
+		uint64_t v;
+		memcpy(&v, p, sizeof v);
+		reg = crc32x(reg, v);
+	}
+	for (; len > 0; len--)
+		reg = crc32b(reg, *p++);
+	return reg;
+}
+
+#endif
+
+static void init(void)
+{
+	if (update != NULL)
+		return;
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; k++)
+			c = c & 1 ? (c >> 1) ^ POLY : c >> 1;
+		table[0][i] = c;
+	}
+	for (uint32_t i = 0; i < 256; i++)
+		for (int t = 1; t < 16; t++)
+			table[t][i] = (table[t-1][i] >> 8) ^ table[0][table[t-1][i] & 0xFF];
+
+	update = updateSlicing16;
+	implementation = "slicing-by-16";
+	const char *force = getenv("BENCH_CRC");
+	if (force != NULL && strcmp(force, "portable") == 0)
+		return;
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("pclmul")) {
+		update = updatePclmul;
+		implementation = "pclmulqdq";
+	}
+#elif defined(__aarch64__)
+	if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+		update = updateArmv8;
+		implementation = "armv8-crc32";
+	}
+#endif
+}
+
+uint32_t benchCrc32Update(uint32_t reg, const void *buf, size_t len)
+{
+	init();
+	return update(reg, buf, len);
+}
+
+uint32_t benchCrc32(uint32_t crc, const void *buf, size_t len)
+{
+	return ~benchCrc32Update(~crc, buf, len);
+}
+
+uint32_t benchCrc32Multiply(uint32_t a, uint32_t b)
+{
+	uint32_t product = 0;
+	for (uint32_t m = 1u << 31; m != 0 && a != 0; m >>= 1) {
+		if (a & m) {
+			product ^= b;
+			a &= ~m;
+		}
+		b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+	}
+	return product;
+}
+
+uint32_t benchCrc32Zeros(size_t n)
+{
+	uint32_t result = 1u << 31;
+	uint32_t power = 1u << 23;
+	for (; n != 0; n >>= 1) {
+		if (n & 1)
+			result = benchCrc32Multiply(result, power);
+		power = benchCrc32Multiply(power, power);
+	}
+	return result;
+}
+
+const char *benchCrc32Implementation(void)
+{
+	init();
+	return implementation;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BENCHCRC_H_
+#define BENCHCRC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* CRC-32 with the zlib polynomial, which all the reference CRC tables were
+ * made with. The fastest implementation the CPU supports is chosen on first
+ * use: PCLMULQDQ folding on x86-64, the CRC32 instructions on AArch64, or
+ * else slicing by 16 bytes at a time. Setting BENCH_CRC=portable forces the
+ * last of these, for comparison purposes. */
+
+/* Continue a CRC over another buffer; start with 0 */
+uint32_t benchCrc32(uint32_t crc, const void *buf, size_t len);
+
+/* Advance the CRC register over a buffer, without the inversions before and
+ * after. The register is linear in the data, which benchCrc32() is not. */
+uint32_t benchCrc32Update(uint32_t reg, const void *buf, size_t len);
+
+/* Multiply two polynomials modulo the CRC polynomial, in the bit-reversed
+ * form that the CRC register uses, where the top bit is x^0 */
+uint32_t benchCrc32Multiply(uint32_t a, uint32_t b);
+
+/* x^(8n) modulo the CRC polynomial. Multiplying a CRC register by this has
+ * the same effect as feeding it n zero bytes. */
+uint32_t benchCrc32Zeros(size_t n);
+
+/* Name of the implementation in use */
+const char *benchCrc32Implementation(void);
+
+#endif /* BENCHCRC_H_ */
@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "BenchReport.h"
+
+static int format;
+static const char *harnessName;
+static unsigned records;
+
+void reportBegin(int fmt, const char *harness)
+{
+	format = fmt;
+	harnessName = harness;
+	records = 0;
+	if (format == REPORT_CSV)
+		printf("harness,rule,srcDepth,destDepth,colorMap,halftone,test,median,min,p95,mblits,samples,cyclesPerPixel,instructionsPerPixel,l1dMissesPerPixel,llcMissesPerPixel,branchMissesPerPixel\n");
+	else if (format == REPORT_JSON)
+		printf("[\n");
+}
+
+void reportRecord(const report_record_t *r)
+{
+	if (format == REPORT_CSV) {
+		printf("%s,%s,%d,%d,%s,%d,%s,%.2f,%.2f,%.2f,", harnessName, r->rule, r->srcDepth, r->destDepth, r->colorMap, r->halftone, r->test, r->median, r->min, r->p95);
+		if (r->mblits >= 0)
+			printf("%.4f", r->mblits);
+		printf(",%u", r->samples);
+		for (int i = 0; i < BENCH_COUNTERS; i++) {
+			if (r->perPixel != NULL && r->perPixel[i] >= 0)
+				printf(",%.4f", r->perPixel[i]);
+			else
+				printf(",");
+		}
+		printf("\n");
+	} else if (format == REPORT_JSON) {
+		printf("%s  { \"harness\": \"%s\", \"rule\": \"%s\", \"srcDepth\": %d, \"destDepth\": %d, \"colorMap\": \"%s\", \"halftone\": %s, \"test\": \"%s\", \"median\": %.2f, \"min\": %.2f, \"p95\": %.2f, ",
+				records > 0 ? ",\n" : "", harnessName, r->rule, r->srcDepth, r->destDepth, r->colorMap, r->halftone ? "true" : "false", r->test, r->median, r->min, r->p95);
+		if (r->mblits >= 0)
+			printf("\"mblits\": %.4f, ", r->mblits);
+		printf("\"samples\": %u", r->samples);
+		if (r->perPixel != NULL) {
+			static const char *const key[BENCH_COUNTERS] = { "cyclesPerPixel", "instructionsPerPixel", "l1dMissesPerPixel", "llcMissesPerPixel", "branchMissesPerPixel" };
+			for (int i = 0; i < BENCH_COUNTERS; i++)
+				if (r->perPixel[i] >= 0)
+					printf(", \"%s\": %.4f", key[i], r->perPixel[i]);
+		}
+		printf(" }");
+	}
+	records++;
+	fflush(stdout);
+}
+
+void reportEnd(void)
+{
+	if (format == REPORT_JSON)
+		printf("%s]\n", records > 0 ? "\n" : "");
+}
+
+const char *reportColorMap(bool fixedPart, bool indexedPart, unsigned cmMask)
+{
+	static char buffer[32];
+	unsigned bits = 0;
+
+	for (; cmMask != 0; cmMask >>= 1)
+		bits += cmMask & 1;
+	if (fixedPart && indexedPart)
+		snprintf(buffer, sizeof buffer, "fixed+indexed%u", bits);
+	else if (indexedPart)
+		snprintf(buffer, sizeof buffer, "indexed%u", bits);
+	else if (fixedPart)
+		return "fixed";
+	else
+		return "none";
+	return buffer;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BENCHREPORT_H_
+#define BENCHREPORT_H_
+
+#include <stdbool.h>
+
+#include "BenchCounters.h"
+
+/* Values for the --json and --csv long options, which getopt_long can store
+ * directly into an int */
+typedef enum {
+	REPORT_TEXT,
+	REPORT_CSV,
+	REPORT_JSON
+} report_format_t;
+
+/* One measurement. The fields up to and including test identify it when
+ * comparing runs; the rates are in MB/s, and mblits is negative for tests
+ * that don't count individual operations. perPixel is NULL unless hardware
+ * counters were read, and its negative elements are counters that weren't
+ * available. */
+typedef struct {
+	const char *rule;
+	int srcDepth;
+	int destDepth;
+	const char *colorMap;
+	bool halftone;
+	const char *test;
+	double median;
+	double min;
+	double p95;
+	double mblits;
+	unsigned samples;
+	const double *perPixel;
+} report_record_t;
+
+/* Start the report, emitting any header the format needs. harness names the
+ * program producing the records. Nothing is printed in REPORT_TEXT format,
+ * where the harness does its own formatting. */
+void reportBegin(int format, const char *harness);
+
+/* Emit a record (ignored in REPORT_TEXT format) */
+void reportRecord(const report_record_t *record);
+
+/* Finish the report */
+void reportEnd(void);
+
+/* Describe a colour map as none, fixed, indexed<bits> or fixed+indexed<bits>
+ * (where bits is the width of cmMask), using a static buffer */
+const char *reportColorMap(bool fixedPart, bool indexedPart, unsigned cmMask);
+
+#endif /* BENCHREPORT_H_ */
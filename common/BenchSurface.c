@@ -0,0 +1,174 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <string.h>
+
+#include <sys/mman.h>
+
+#include "BenchSurface.h"
+
+#define MIN(a,b) ((a)<(b)?(a):(b))
+#define MAX(a,b) ((a)>(b)?(a):(b))
+
+static size_t roundUp(size_t bytes)
+{
+	return (bytes + BENCH_SURFACE_ALIGN - 1) & ~(size_t) (BENCH_SURFACE_ALIGN - 1);
+}
+
+void *benchSurfaceAlloc(size_t bytes)
+{
+	/* Over-allocate so an aligned block can be cut out, then give back the
+	 * ends */
+	size_t size = roundUp(bytes);
+	uint8_t *p = mmap(NULL, size + BENCH_SURFACE_ALIGN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+	uint8_t *aligned = (uint8_t *) roundUp((uintptr_t) p);
+	if (aligned > p)
+		munmap(p, aligned - p);
+	if (p + BENCH_SURFACE_ALIGN > aligned)
+		munmap(aligned + size, p + BENCH_SURFACE_ALIGN - aligned);
+#ifdef MADV_HUGEPAGE
+	/* Only advice: without transparent huge pages this does nothing */
+	madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+	return aligned;
+}
+
+void benchSurfaceFree(void *p, size_t bytes)
+{
+	if (p != NULL)
+		munmap(p, roundUp(bytes));
+}
+
+bool benchSurfaceCreate(bench_surface_t *s, size_t bytes, bool restorable)
+{
+	s->bytes = bytes;
+	s->bits = benchSurfaceAlloc(bytes);
+	s->pristine = restorable ? benchSurfaceAlloc(bytes) : NULL;
+	s->rects = 0;
+	s->low = s->high = 0;
+	if (s->bits == NULL || (restorable && s->pristine == NULL)) {
+		benchSurfaceDestroy(s);
+		return false;
+	}
+	return true;
+}
+
+void benchSurfaceDestroy(bench_surface_t *s)
+{
+	benchSurfaceFree(s->bits, s->bytes);
+	benchSurfaceFree(s->pristine, s->bytes);
+	s->bits = s->pristine = NULL;
+}
+
+void benchSurfaceSnapshot(bench_surface_t *s)
+{
+	if (s->pristine != NULL)
+		memcpy(s->pristine, s->bits, s->bytes);
+	s->rects = 0;
+	s->low = s->high = 0;
+}
+
+bench_rect_t benchSurfaceRect(const bench_surface_t *s, size_t pitch, unsigned depth, size_t x, size_t y, size_t w, size_t h)
+{
+	bench_rect_t r;
+	size_t rows = (s->bytes + pitch - 1) / pitch;
+	r.pitch = pitch;
+	r.bottom = MIN(y + h, rows);
+	r.top = MIN(y, r.bottom);
+	r.right = MIN(((x + w) * depth + 31) / 32 * 4, pitch);
+	r.left = MIN(x * depth / 32 * 4, r.right);
+	return r;
+}
+
+/* The range of bytes from the first to the last that a rectangle covers */
+static void extendRange(bench_surface_t *s, const bench_rect_t *r)
+{
+	if (r->top == r->bottom || r->left == r->right)
+		return;
+	size_t low = r->top * r->pitch + r->left;
+	size_t high = MIN((r->bottom - 1) * r->pitch + r->right, s->bytes);
+	if (s->low == s->high) {
+		s->low = low;
+		s->high = high;
+	} else {
+		s->low = MIN(s->low, low);
+		s->high = MAX(s->high, high);
+	}
+}
+
+void benchSurfaceDirty(bench_surface_t *s, const bench_rect_t *r)
+{
+	/* Benchmarks repeat the same blits many times over */
+	for (size_t i = 0; i < s->rects; i++)
+		if (memcmp(&s->rect[i], r, sizeof *r) == 0)
+			return;
+	if (s->rects < BENCH_SURFACE_RECTS) {
+		s->rect[s->rects++] = *r;
+		return;
+	}
+	/* Out of slots, so lump everything together */
+	for (size_t i = 0; i < s->rects; i++)
+		extendRange(s, &s->rect[i]);
+	extendRange(s, r);
+	s->rects = 0;
+}
+
+void benchSurfaceDirtyAll(bench_surface_t *s)
+{
+	s->rects = 0;
+	s->low = 0;
+	s->high = s->bytes;
+}
+
+void benchSurfaceRestore(bench_surface_t *s)
+{
+	uint8_t *bits = s->bits;
+	const uint8_t *pristine = s->pristine;
+	if (s->low < s->high)
+		memcpy(bits + s->low, pristine + s->low, s->high - s->low);
+	for (size_t i = 0; i < s->rects; i++) {
+		const bench_rect_t *r = &s->rect[i];
+		if (r->left == 0 && r->right == r->pitch) {
+			/* Whole rows, so in one go */
+			size_t low = r->top * r->pitch;
+			size_t high = MIN(r->bottom * r->pitch, s->bytes);
+			if (low < high)
+				memcpy(bits + low, pristine + low, high - low);
+			continue;
+		}
+		for (size_t y = r->top; y < r->bottom; y++) {
+			size_t low = y * r->pitch + r->left;
+			size_t high = MIN(y * r->pitch + r->right, s->bytes);
+			if (low < high)
+				memcpy(bits + low, pristine + low, high - low);
+		}
+	}
+	s->rects = 0;
+	s->low = s->high = 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BENCHSURFACE_H_
+#define BENCHSURFACE_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Surfaces for the test harnesses. Each one is a separate anonymous mapping,
+ * aligned to 2MB and backed by transparent huge pages where the kernel
+ * allows, so big surfaces don't thrash the TLB. They are all made before
+ * anything is timed or fuzzed, and nothing is allocated after that.
+ *
+ * A restorable surface also keeps a pristine copy of its contents. Callers
+ * record the rectangles that each operation may write, and restoring copies
+ * back only those, so resetting a surface costs in proportion to the blit
+ * rather than to the surface. */
+
+#define BENCH_SURFACE_ALIGN (2*1024*1024)
+
+/* Dirty rectangles tracked individually before they are merged into one
+ * range of bytes */
+#define BENCH_SURFACE_RECTS (8)
+
+/* Rows [top, bottom) and bytes [left, right) within each row, of a surface
+ * laid out with the given pitch */
+typedef struct {
+	size_t pitch;
+	size_t top;
+	size_t bottom;
+	size_t left;
+	size_t right;
+} bench_rect_t;
+
+typedef struct {
+	void         *bits;
+	void         *pristine;
+	size_t        bytes;
+	size_t        rects;
+	bench_rect_t  rect[BENCH_SURFACE_RECTS];
+	/* Everything else that is dirty, as bytes [low, high) */
+	size_t        low;
+	size_t        high;
+} bench_surface_t;
+
+/* Allocate and release aligned, huge page backed memory, which starts zeroed */
+void *benchSurfaceAlloc(size_t bytes);
+void benchSurfaceFree(void *p, size_t bytes);
+
+/* Make a zeroed surface of the given size, with a pristine copy if it is to
+ * be restorable. Returns false if there isn't enough memory. */
+bool benchSurfaceCreate(bench_surface_t *s, size_t bytes, bool restorable);
+void benchSurfaceDestroy(bench_surface_t *s);
+
+/* Take the current contents as the pristine copy, and mark nothing dirty */
+void benchSurfaceSnapshot(bench_surface_t *s);
+
+/* The bytes and rows holding pixels [x, x + w) of rows [y, y + h) at the
+ * given depth, rounded out to whole words and clipped to the surface */
+bench_rect_t benchSurfaceRect(const bench_surface_t *s, size_t pitch, unsigned depth, size_t x, size_t y, size_t w, size_t h);
+
+/* Note that a rectangle may be written, or that all of the surface may */
+void benchSurfaceDirty(bench_surface_t *s, const bench_rect_t *r);
+void benchSurfaceDirtyAll(bench_surface_t *s);
+
+/* Copy the dirty parts back from the pristine copy, and mark nothing dirty */
+void benchSurfaceRestore(bench_surface_t *s);
+
+#endif /* BENCHSURFACE_H_ */
@@ -0,0 +1,171 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <sched.h>
+#include <time.h>
+
+#include "BenchTiming.h"
+
+#ifndef CLOCK_MONOTONIC_RAW
+#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
+
+static double confidence = BENCH_DEFAULT_CONFIDENCE;
+static uint64_t timeLimit = BENCH_MAX_NANOSECONDS;
+
+uint64_t benchTimeNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void benchSetConfidence(double fraction)
+{
+	confidence = fraction;
+}
+
+bool benchPinCpu(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof set, &set) != 0) {
+		perror("sched_setaffinity");
+		return false;
+	}
+	return true;
+}
+
+void benchSetTimeLimit(uint64_t ns)
+{
+	timeLimit = ns;
+}
+
+void benchSamplerInit(bench_sampler_t *s)
+{
+	s->count = 0;
+	s->warmup = BENCH_WARMUP_RUNS;
+	s->elapsed = 0;
+}
+
+void benchSamplerAdd(bench_sampler_t *s, uint64_t ns)
+{
+	if (s->warmup > 0) {
+		s->warmup--;
+		return;
+	}
+	if (s->count == BENCH_MAX_SAMPLES)
+		return;
+	s->elapsed += ns;
+	/* Insertion sort - there are never very many samples */
+	unsigned i;
+	for (i = s->count++; i > 0 && s->sample[i-1] > ns; i--)
+		s->sample[i] = s->sample[i-1];
+	s->sample[i] = ns;
+}
+
+static double median(const bench_sampler_t *s)
+{
+	unsigned n = s->count;
+	if (n & 1)
+		return s->sample[n/2];
+	else
+		return (s->sample[n/2-1] + s->sample[n/2]) / 2.0;
+}
+
+static bool converged(const bench_sampler_t *s)
+{
+	/* Distribution-free confidence interval for the median: the order
+	 * statistics either side of n/2 by 1.96*sqrt(n)/2 */
+	unsigned n = s->count;
+	if (n < BENCH_MIN_SAMPLES)
+		return false;
+	double spread = 1.96 * sqrt(n) / 2;
+	int lo = (int) floor(n / 2.0 - spread);
+	int hi = (int) ceil(n / 2.0 + spread);
+	if (lo < 0)
+		lo = 0;
+	if (hi > (int) n - 1)
+		hi = n - 1;
+	double m = median(s);
+	return m - s->sample[lo] <= m * confidence && s->sample[hi] - m <= m * confidence;
+}
+
+bool benchSamplerDone(const bench_sampler_t *s)
+{
+	if (s->count == BENCH_MAX_SAMPLES)
+		return true;
+	if (s->elapsed >= timeLimit && s->count > 0)
+		return true;
+	return converged(s);
+}
+
+void benchSamplerStats(const bench_sampler_t *s, bench_stats_t *stats)
+{
+	unsigned n = s->count;
+	memset(stats, 0, sizeof *stats);
+	if (n == 0)
+		return;
+	unsigned rank = (unsigned) ceil(0.95 * n);
+	stats->median = median(s);
+	stats->min = s->sample[0];
+	stats->p95 = s->sample[rank > 0 ? rank - 1 : 0];
+	stats->samples = n;
+	stats->converged = converged(s);
+}
+
+void benchMeasure(void (*fn)(void *arg), void *arg, bench_stats_t *stats)
+{
+	bench_sampler_t s;
+	benchSamplerInit(&s);
+	do {
+		uint64_t t = benchTimeNow();
+		fn(arg);
+		benchSamplerAdd(&s, benchTimeNow() - t);
+	} while (!benchSamplerDone(&s));
+	benchSamplerStats(&s, stats);
+}
+
+static double subtract(double value, double overhead)
+{
+	return overhead < value / 2 ? value - overhead : value / 2;
+}
+
+void benchSubtractControl(bench_stats_t *stats, const bench_stats_t *control)
+{
+	stats->median = subtract(stats->median, control->median);
+	stats->min = subtract(stats->min, control->median);
+	stats->p95 = subtract(stats->p95, control->median);
+}
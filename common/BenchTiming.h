@@ -0,0 +1,87 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BENCHTIMING_H_
+#define BENCHTIMING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Untimed runs made before sampling starts */
+#define BENCH_WARMUP_RUNS (2)
+/* Sampling continues until at least this many samples have been taken... */
+#define BENCH_MIN_SAMPLES (5)
+/* ...and the 95% confidence interval of the median is within this fraction
+ * of the median either way... */
+#define BENCH_DEFAULT_CONFIDENCE (0.01)
+/* ...or until either of these limits is reached */
+#define BENCH_MAX_SAMPLES (200)
+#define BENCH_MAX_NANOSECONDS (5000000000ull)
+
+/* All times are in nanoseconds */
+typedef struct {
+	double median;
+	double min;
+	double p95;
+	unsigned samples;
+	bool converged;
+} bench_stats_t;
+
+typedef struct {
+	uint64_t sample[BENCH_MAX_SAMPLES]; /* kept sorted */
+	unsigned count;
+	unsigned warmup;
+	uint64_t elapsed;
+} bench_sampler_t;
+
+/* Read the monotonic clock, unaffected by NTP slewing where possible */
+uint64_t benchTimeNow(void);
+
+/* Change the confidence target, as a fraction of the median */
+void benchSetConfidence(double fraction);
+
+/* Change the time limit for sampling a single measurement */
+void benchSetTimeLimit(uint64_t ns);
+
+/* Restrict the process to a single CPU, so samples aren't disturbed by
+ * migrations. Returns false (having printed why) on failure. */
+bool benchPinCpu(int cpu);
+
+/* For harnesses that need to interleave more than one measurement. Pass
+ * the duration of each run to benchSamplerAdd() until benchSamplerDone()
+ * returns true; the warm-up runs are discarded automatically. */
+void benchSamplerInit(bench_sampler_t *s);
+void benchSamplerAdd(bench_sampler_t *s, uint64_t ns);
+bool benchSamplerDone(const bench_sampler_t *s);
+void benchSamplerStats(const bench_sampler_t *s, bench_stats_t *stats);
+
+/* Time repeated calls of fn(arg) until the confidence target is met */
+void benchMeasure(void (*fn)(void *arg), void *arg, bench_stats_t *stats);
+
+/* Remove the overheads measured by a control run. Noise can make the control
+ * appear as slow as the test on fast runs, so no more than half of each
+ * statistic is ever subtracted, which keeps the results positive. */
+void benchSubtractControl(bench_stats_t *stats, const bench_stats_t *control);
+
+#endif /* BENCHTIMING_H_ */
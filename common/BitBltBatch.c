@@ -0,0 +1,54 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#include <stdint.h>
+
+#include "BitBltDispatch.h"
+#include "BitBltBatch.h"
+#ifdef __x86_64__
+#include "BitBltX64.h"
+#endif
+
+void copyBitsDispatchBatch(operation_t *op, const blit_rect_t *rects, size_t count)
+{
+	/* The x86-64 kernels don't depend upon the geometry, so one lookup serves
+	 * the whole batch. Anything else goes through the dispatcher each time. */
+	void (*kernel)(operation_t *, uint32_t) = NULL;
+#ifdef __x86_64__
+	if (count > 0)
+		kernel = x64LookupFastPath(op);
+#endif
+	for (; count > 0; count--, rects++) {
+		op->src.x = rects->src_x;
+		op->src.y = rects->src_y;
+		op->dest.x = rects->dest_x;
+		op->dest.y = rects->dest_y;
+		op->width = rects->width;
+		op->height = rects->height;
+		if (kernel != NULL)
+			kernel(op, 0);
+		else
+			copyBitsDispatch(op);
+	}
+}
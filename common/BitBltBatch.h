@@ -0,0 +1,48 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BITBLTBATCH_H_
+#define BITBLTBATCH_H_
+
+#include <stddef.h>
+
+#include "BitBltDispatch.h"
+
+/* Geometry of one blit within a batch */
+typedef struct {
+	size_t src_x;
+	size_t src_y;
+	size_t dest_x;
+	size_t dest_y;
+	size_t width;
+	size_t height;
+} blit_rect_t;
+
+/* Perform a series of blits which share every setting in op (forms, rule,
+ * colour map, halftone and so on) apart from their geometry, which is taken
+ * from rects in turn. The fast path is looked up once for the whole batch.
+ * On return, op holds the geometry of the last blit. */
+void copyBitsDispatchBatch(operation_t *op, const blit_rect_t *rects, size_t count);
+
+#endif /* BITBLTBATCH_H_ */
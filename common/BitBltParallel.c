@@ -0,0 +1,154 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <pthread.h>
+
+#include "BitBltDispatch.h"
+#include "BitBltParallel.h"
+#ifdef __x86_64__
+#include "BitBltX64.h"
+#endif
+
+typedef void (*kernel_t)(operation_t *op, uint32_t flags);
+
+static unsigned nThreads = 1;
+static size_t threshold = PARALLEL_DEFAULT_THRESHOLD;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t finished = PTHREAD_COND_INITIALIZER;
+static uint32_t generation;
+static unsigned outstanding;
+
+/* The current job; only written while all workers are idle */
+static operation_t job;
+static kernel_t jobKernel;
+static unsigned jobBands;
+
+static void runBand(unsigned band)
+{
+	size_t first = job.height * band / jobBands;
+	size_t last = job.height * (band + 1) / jobBands;
+	operation_t bandOp = job;
+	bandOp.src.y += first;
+	bandOp.dest.y += first;
+	bandOp.height = last - first;
+	if (bandOp.height > 0)
+		jobKernel(&bandOp, 0);
+}
+
+static void *worker(void *arg)
+{
+	unsigned band = (unsigned) (uintptr_t) arg;
+	uint32_t seen = 0;
+	pthread_mutex_lock(&lock);
+	for (;;) {
+		while (generation == seen)
+			pthread_cond_wait(&wake, &lock);
+		seen = generation;
+		pthread_mutex_unlock(&lock);
+		if (band < jobBands)
+			runBand(band);
+		pthread_mutex_lock(&lock);
+		if (--outstanding == 0)
+			pthread_cond_signal(&finished);
+	}
+	return NULL;
+}
+
+unsigned parallelCopyBitsInit(unsigned threads)
+{
+	while (nThreads < threads) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, worker, (void *) (uintptr_t) nThreads) != 0)
+			break;
+		pthread_detach(thread);
+		nThreads++;
+	}
+	return nThreads;
+}
+
+void parallelCopyBitsSetThreshold(size_t bytes)
+{
+	threshold = bytes;
+}
+
+static kernel_t reentrantKernel(const operation_t *op)
+{
+#ifdef __x86_64__
+	return x64LookupFastPath(op);
+#else
+	(void) op;
+	return NULL;
+#endif
+}
+
+void copyBitsDispatchParallel(operation_t *op)
+{
+	size_t bytes = ((uint64_t) op->width * op->height * op->dest.depth) >> 3;
+	unsigned bands = op->height / PARALLEL_MIN_BAND_ROWS;
+	if (bands > nThreads)
+		bands = nThreads;
+	kernel_t kernel = NULL;
+
+	if (bands > 1 && bytes >= threshold &&
+			op->combinationRule != CR_tallyIntoMap &&
+			op->combinationRule != CR_OLDtallyIntoMap)
+		kernel = reentrantKernel(op);
+
+	/* Within one form, bands can only run concurrently if each reads and
+	 * writes the same rows; otherwise leave the whole blit to
+	 * copyBitsDispatch(), since the x86-64 kernels and the generic code all
+	 * order their rows and pixels correctly when run on the whole blit */
+	if (kernel != NULL && !op->noSource && op->src.bits == op->dest.bits && op->src.y != op->dest.y) {
+		size_t dy = op->src.y > op->dest.y ? op->src.y - op->dest.y : op->dest.y - op->src.y;
+		if (dy < (size_t) op->height)
+			kernel = NULL;
+	}
+
+	if (kernel == NULL) {
+		copyBitsDispatch(op);
+		return;
+	}
+
+	pthread_mutex_lock(&lock);
+	job = *op;
+	jobKernel = kernel;
+	jobBands = bands;
+	outstanding = nThreads - 1;
+	generation++;
+	pthread_cond_broadcast(&wake);
+	pthread_mutex_unlock(&lock);
+
+	runBand(0);
+
+	pthread_mutex_lock(&lock);
+	while (outstanding > 0)
+		pthread_cond_wait(&finished, &lock);
+	pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BITBLTPARALLEL_H_
+#define BITBLTPARALLEL_H_
+
+#include <stddef.h>
+
+#include "BitBltDispatch.h"
+
+/* Blits whose destination is at least this many bytes are considered for
+ * splitting into bands; smaller ones aren't worth waking the workers for. */
+#define PARALLEL_DEFAULT_THRESHOLD (256*1024)
+/* Never make a band shorter than this */
+#define PARALLEL_MIN_BAND_ROWS (8)
+
+/* Start the worker pool. The calling thread takes part in every parallel
+ * blit, so threads-1 workers are created. Returns the number of threads
+ * actually available, which is 1 if no workers could be started. */
+unsigned parallelCopyBitsInit(unsigned threads);
+
+/* Change the size threshold (in destination bytes) for splitting blits */
+void parallelCopyBitsSetThreshold(size_t bytes);
+
+/* Equivalent to copyBitsDispatch(op), but large blits are split into
+ * horizontal bands which are processed concurrently by the worker pool.
+ * A blit stays on the calling thread if it is below the size threshold, if
+ * it would be handled by the (non-reentrant) generic code, if it updates the
+ * colour map, or if bands would read rows that other bands write. */
+void copyBitsDispatchParallel(operation_t *op);
+
+#endif /* BITBLTPARALLEL_H_ */
@@ -0,0 +1,426 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+/* Dispatch telemetry, interposed on the dispatcher with the linker's --wrap
+ * option. See BitBltStats.h. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "BitBltStats.h"
+#include "BitBltTrace.h"
+#ifdef __x86_64__
+#include "BitBltX64.h"
+#endif
+
+/* Provided by the linker when the corresponding --wrap options are used */
+void __real_copyBitsDispatch(operation_t *op);
+void __real_copyBitsFallback(operation_t *op, unsigned int flags);
+uint32_t __real_compareColorsDispatch(compare_operation_t *op);
+uint32_t __real_compareColorsFallback(compare_operation_t *op, unsigned int flags);
+
+void __wrap_copyBitsDispatch(operation_t *op);
+void __wrap_copyBitsFallback(operation_t *op, unsigned int flags);
+uint32_t __wrap_compareColorsDispatch(compare_operation_t *op);
+uint32_t __wrap_compareColorsFallback(compare_operation_t *op, unsigned int flags);
+
+static const char *const ruleNames[] = {
+	"clearWord",
+	"bitAnd",
+	"bitAndInvert",
+	"sourceWord",
+	"bitInvertAnd",
+	"destinationWord",
+	"bitXor",
+	"bitOr",
+	"bitInvertAndInvert",
+	"bitInvertXor",
+	"bitInvertDestination",
+	"bitOrInvert",
+	"bitInvertSource",
+	"bitInvertOr",
+	"bitInvertOrInvert",
+	"destinationWord_alt1",
+	"destinationWord_alt2",
+	"destinationWord_alt3",
+	"addWord",
+	"subWord",
+	"rgbAdd",
+	"rgbSub",
+	"OLDrgbDiff",
+	"OLDtallyIntoMap",
+	"alphaBlend",
+	"pixPaint",
+	"pixMask",
+	"rgbMax",
+	"rgbMin",
+	"rgbMinInvert",
+	"alphaBlendConst",
+	"alphaPaintConst",
+	"rgbDiff",
+	"tallyIntoMap",
+	"alphaBlendScaled",
+	"alphaBlendScaled_alt1",
+	"alphaBlendScaled_alt2",
+	"rgbMul",
+	"pixSwap",
+	"pixClear",
+	"fixAlpha",
+	"rgbComponentAlpha",
+};
+
+static const char *const matchRuleNames[] = {
+	"pixelMatch",
+	"notAnotB",
+	"notAmatchB",
+};
+
+/* Compared by address, so kept out of the string pool */
+static const char implFallback[] = "fallback";
+static const char implFastPath[] = "fast path";
+
+typedef struct {
+	/* Key. A NULL impl marks an unused slot. isa is only set for kernels
+	 * that come in several instruction set variants. */
+	const char *impl;
+	const char *isa;
+	bool        compare;
+	uint8_t     rule;
+	uint8_t     srcDepth;
+	uint8_t     destDepth;
+	uint8_t     cmFlags;
+	bool        halftone;
+	bool        tally;
+	/* Counts */
+	uint64_t    calls;
+	uint64_t    pixels;
+} entry_t;
+
+/* Comfortably more than the number of distinct keys any program generates;
+ * must be a power of 2 */
+#define SLOTS 4096
+
+static entry_t table[SLOTS];
+static uint64_t lostCalls;
+
+static bool enabled;
+static bool environmentChecked;
+static const char *dumpPath;
+
+/* Set while the dispatcher is running, so that a fallback call from inside it
+ * is attributed to the dispatched call rather than counted separately */
+static __thread bool inDispatch;
+static __thread bool fellBack;
+
+static void dumpAtExit(void)
+{
+	FILE *f = stderr;
+	if (strcmp(dumpPath, "1") != 0) {
+		f = fopen(dumpPath, "a");
+		if (f == NULL) {
+			fprintf(stderr, "Unable to open %s for BitBlt statistics\n", dumpPath);
+			return;
+		}
+	}
+	bitBltStatsDump(f);
+	if (f != stderr)
+		fclose(f);
+}
+
+static void checkEnvironment(void)
+{
+	if (environmentChecked)
+		return;
+	environmentChecked = true;
+	const char *env = getenv("BITBLT_STATS");
+	if (env != NULL && *env != '\0') {
+		enabled = true;
+		dumpPath = env;
+		atexit(dumpAtExit);
+	}
+	env = getenv("BITBLT_TRACE");
+	if (env != NULL && *env != '\0')
+		bitBltTraceOpen(env);
+}
+
+static inline bool recording(void)
+{
+	if (!environmentChecked)
+		checkEnvironment();
+	return enabled;
+}
+
+/* True if either statistics or a trace are being recorded */
+static inline bool watching(void)
+{
+	return recording() || bitBltTracing();
+}
+
+void bitBltStatsEnable(void)
+{
+	checkEnvironment();
+	enabled = true;
+}
+
+void bitBltStatsReset(void)
+{
+	memset(table, 0, sizeof table);
+	lostCalls = 0;
+}
+
+static size_t hashKey(const entry_t *key)
+{
+	uint32_t h = (uint32_t) (uintptr_t) key->impl ^ (uint32_t) (uintptr_t) key->isa;
+	h = h * 31 + key->compare;
+	h = h * 31 + key->rule;
+	h = h * 31 + key->srcDepth;
+	h = h * 31 + key->destDepth;
+	h = h * 31 + key->cmFlags;
+	h = h * 31 + key->halftone;
+	h = h * 31 + key->tally;
+	h ^= h >> 15;
+	h *= 0x2C1B3C6D;
+	h ^= h >> 12;
+	return h & (SLOTS - 1);
+}
+
+static bool sameKey(const entry_t *a, const entry_t *b)
+{
+	return a->impl == b->impl &&
+	       a->isa == b->isa &&
+	       a->compare == b->compare &&
+	       a->rule == b->rule &&
+	       a->srcDepth == b->srcDepth &&
+	       a->destDepth == b->destDepth &&
+	       a->cmFlags == b->cmFlags &&
+	       a->halftone == b->halftone &&
+	       a->tally == b->tally;
+}
+
+static void record(const entry_t *key, uint64_t pixels)
+{
+	size_t i = hashKey(key);
+	for (size_t probes = 0; probes < SLOTS; probes++, i = (i + 1) & (SLOTS - 1)) {
+		entry_t *e = &table[i];
+		if (e->impl == NULL) {
+			*e = *key;
+			e->calls = 0;
+			e->pixels = 0;
+		} else if (!sameKey(e, key)) {
+			continue;
+		}
+		e->calls++;
+		e->pixels += pixels;
+		return;
+	}
+	lostCalls++;
+}
+
+static void copyKey(entry_t *key, const operation_t *op)
+{
+	memset(key, 0, sizeof *key);
+	key->rule = op->combinationRule;
+	key->srcDepth = op->noSource ? 0 : op->src.depth;
+	key->destDepth = op->dest.depth;
+	key->cmFlags = op->cmFlags;
+	key->halftone = !op->noHalftone;
+}
+
+static void compareKey(entry_t *key, const compare_operation_t *op)
+{
+	memset(key, 0, sizeof *key);
+	key->compare = true;
+	key->rule = op->matchRule;
+	key->srcDepth = op->srcA.depth;
+	key->destDepth = op->srcB.depth;
+	key->tally = op->tally;
+}
+
+/* The dispatcher, extended with the x86-64 fast paths that it has no flags
+ * to select */
+static void dispatchCopy(operation_t *op)
+{
+#ifdef __x86_64__
+	x64_kernel_t kernel = x64LookupUndispatchedFastPath(op);
+	if (kernel != NULL) {
+		kernel(op, 0);
+		return;
+	}
+#endif
+	__real_copyBitsDispatch(op);
+}
+
+void __wrap_copyBitsDispatch(operation_t *op)
+{
+	if (inDispatch || !watching()) {
+		dispatchCopy(op);
+		return;
+	}
+	if (bitBltTracing())
+		bitBltTraceCopy(op);
+	if (!enabled) {
+		dispatchCopy(op);
+		return;
+	}
+	entry_t key;
+	copyKey(&key, op);
+	uint64_t pixels = (uint64_t) op->width * op->height;
+#ifdef __x86_64__
+	if (!x64DescribeFastPath(op, &key.impl, &key.isa))
+		key.impl = key.isa = NULL;
+#endif
+	inDispatch = true;
+	fellBack = false;
+	dispatchCopy(op);
+	inDispatch = false;
+	if (fellBack) {
+		key.impl = implFallback;
+		key.isa = NULL;
+	} else if (key.impl == NULL) {
+		key.impl = implFastPath;
+	}
+	record(&key, pixels);
+}
+
+void __wrap_copyBitsFallback(operation_t *op, unsigned int flags)
+{
+	if (recording()) {
+		if (inDispatch) {
+			fellBack = true;
+		} else {
+			/* Called directly, bypassing the dispatcher */
+			entry_t key;
+			copyKey(&key, op);
+			key.impl = implFallback;
+			record(&key, (uint64_t) op->width * op->height);
+		}
+	}
+	__real_copyBitsFallback(op, flags);
+}
+
+uint32_t __wrap_compareColorsDispatch(compare_operation_t *op)
+{
+	if (inDispatch || !watching())
+		return __real_compareColorsDispatch(op);
+	if (bitBltTracing())
+		bitBltTraceCompare(op);
+	if (!enabled)
+		return __real_compareColorsDispatch(op);
+	entry_t key;
+	compareKey(&key, op);
+	uint64_t pixels = (uint64_t) op->width * op->height;
+	inDispatch = true;
+	fellBack = false;
+	uint32_t result = __real_compareColorsDispatch(op);
+	inDispatch = false;
+	key.impl = fellBack ? implFallback : implFastPath;
+	record(&key, pixels);
+	return result;
+}
+
+uint32_t __wrap_compareColorsFallback(compare_operation_t *op, unsigned int flags)
+{
+	if (recording()) {
+		if (inDispatch) {
+			fellBack = true;
+		} else {
+			entry_t key;
+			compareKey(&key, op);
+			key.impl = implFallback;
+			record(&key, (uint64_t) op->width * op->height);
+		}
+	}
+	return __real_compareColorsFallback(op, flags);
+}
+
+static int byPixels(const void *a, const void *b)
+{
+	const entry_t *ea = *(const entry_t *const *) a;
+	const entry_t *eb = *(const entry_t *const *) b;
+	if (ea->pixels != eb->pixels)
+		return ea->pixels < eb->pixels ? 1 : -1;
+	if (ea->calls != eb->calls)
+		return ea->calls < eb->calls ? 1 : -1;
+	return 0;
+}
+
+static const char *colorMapName(uint8_t cmFlags)
+{
+	if ((cmFlags & ColorMapPresent) == 0)
+		return "none";
+	switch (cmFlags & (ColorMapFixedPart | ColorMapIndexedPart)) {
+	case ColorMapFixedPart:                       return "fixed";
+	case ColorMapIndexedPart:                     return "indexed";
+	case ColorMapFixedPart | ColorMapIndexedPart: return "fixed+indexed";
+	}
+	return "present";
+}
+
+void bitBltStatsDump(FILE *f)
+{
+	static entry_t *sorted[SLOTS];
+	size_t used = 0;
+	uint64_t totalCalls = lostCalls, totalPixels = 0, fallbackPixels = 0;
+	for (size_t i = 0; i < SLOTS; i++) {
+		if (table[i].impl == NULL)
+			continue;
+		sorted[used++] = &table[i];
+		totalCalls += table[i].calls;
+		totalPixels += table[i].pixels;
+		if (table[i].impl == implFallback)
+			fallbackPixels += table[i].pixels;
+	}
+	qsort(sorted, used, sizeof *sorted, byPixels);
+
+	fprintf(f, "BitBlt dispatch statistics: %" PRIu64 " calls, %" PRIu64 " pixels, %.1f%% of pixels in fallback code\n",
+			totalCalls, totalPixels, totalPixels == 0 ? 0.0 : 100.0 * fallbackPixels / totalPixels);
+	fprintf(f, "%-8s %-22s %3s %3s %-13s %-2s %12s %15s %6s  %s\n",
+			"Kind", "Rule", "Src", "Dst", "Color map", "HT", "Calls", "Pixels", "Share", "Implementation");
+	for (size_t i = 0; i < used; i++) {
+		const entry_t *e = sorted[i];
+		const char *rule;
+		if (e->compare)
+			rule = e->rule < sizeof matchRuleNames / sizeof *matchRuleNames ? matchRuleNames[e->rule] : "?";
+		else
+			rule = e->rule < sizeof ruleNames / sizeof *ruleNames ? ruleNames[e->rule] : "?";
+		fprintf(f, "%-8s %-22s %3u %3u %-13s %-2s %12" PRIu64 " %15" PRIu64 " %5.1f%%  %s%s%s\n",
+				e->compare ? (e->tally ? "tally" : "compare") : "copy",
+				rule,
+				e->srcDepth,
+				e->destDepth,
+				e->compare ? "-" : colorMapName(e->cmFlags),
+				e->compare ? "-" : e->halftone ? "y" : "n",
+				e->calls,
+				e->pixels,
+				totalPixels == 0 ? 0.0 : 100.0 * e->pixels / totalPixels,
+				e->impl,
+				e->isa == NULL ? "" : "/",
+				e->isa == NULL ? "" : e->isa);
+	}
+	if (lostCalls != 0)
+		fprintf(f, "(%" PRIu64 " calls not broken down: table full)\n", lostCalls);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BITBLTSTATS_H_
+#define BITBLTSTATS_H_
+
+#include <stdio.h>
+
+#include "BitBltDispatch.h"
+
+/* Dispatch telemetry. The dispatcher lives in the VM tree, so rather than
+ * patching it, this module interposes on its entry points. Link it in with
+ *
+ *   -Wl,--wrap=copyBitsDispatch,--wrap=copyBitsFallback
+ *   -Wl,--wrap=compareColorsDispatch,--wrap=compareColorsFallback
+ *
+ * together with BitBltTrace, and every call is then counted against its
+ * (rule, source depth, destination depth, colour map flags, halftone) key,
+ * together with the number of pixels processed and the implementation that
+ * served it: an x86-64 kernel, some other fast path, or the generic fallback
+ * code.
+ *
+ * Recording is off unless bitBltStatsEnable() is called or the BITBLT_STATS
+ * environment variable is set. BITBLT_STATS=1 prints the table to stderr at
+ * exit; any other value is taken as the name of a file to append it to.
+ *
+ * The same interposer also records BITBLT_TRACE traces; see BitBltTrace.h.
+ * On x86-64 it also hands blits that the dispatcher has no flags for, but an
+ * x86-64 kernel handles, straight to that kernel (see
+ * x64LookupUndispatchedFastPath()), so programs linked with it reach those
+ * kernels through copyBitsDispatch().
+ *
+ * Like the generic code it watches, this is not thread-safe: only calls into
+ * the dispatcher from one thread at a time are counted reliably. */
+
+/* Start recording, if it hasn't been already */
+void bitBltStatsEnable(void);
+
+/* Discard everything recorded so far */
+void bitBltStatsReset(void);
+
+/* Print the table, busiest keys first */
+void bitBltStatsDump(FILE *f);
+
+#endif /* BITBLTSTATS_H_ */
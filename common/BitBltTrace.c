@@ -0,0 +1,502 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+/* Binary trace recording and loading. See BitBltTrace.h. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "BitBltTrace.h"
+
+#define TRACE_MAGIC      (0x52544242) /* "BBTR" */
+#define TRACE_VERSION    (1)
+#define TRACE_BYTE_ORDER (0x01020304)
+
+enum {
+	TAG_TABLE = 1,
+	TAG_COPY,
+	TAG_COMPARE,
+};
+
+/* Each surface is written as these words... */
+enum {
+	S_SURFACE,
+	S_DEPTH,
+	S_PITCH,
+	S_MSB,
+	S_X,
+	S_Y,
+	SURFACE_WORDS
+};
+
+/* ...within a copy record... */
+enum {
+	C_RULE,
+	C_NO_SOURCE,
+	C_SRC,
+	C_DEST = C_SRC + SURFACE_WORDS,
+	C_WIDTH = C_DEST + SURFACE_WORDS,
+	C_HEIGHT,
+	C_CM_FLAGS,
+	C_CM_MASK,
+	C_CM_MASK_TABLE,
+	C_CM_SHIFT_TABLE,
+	C_CM_LOOKUP_TABLE,
+	C_NO_HALFTONE,
+	C_HALFTONE_HEIGHT,
+	C_HALFTONE,
+	C_OPT_0,
+	C_OPT_1,
+	C_GAMMA,
+	C_UNGAMMA,
+	COPY_WORDS
+};
+
+/* ...or a compare record. Tables are referred to by number, 0 meaning
+ * none. */
+enum {
+	M_MATCH_RULE,
+	M_TALLY,
+	M_SRC_A,
+	M_SRC_B = M_SRC_A + SURFACE_WORDS,
+	M_WIDTH = M_SRC_B + SURFACE_WORDS,
+	M_HEIGHT,
+	M_COLOR_A,
+	M_COLOR_B,
+	COMPARE_WORDS
+};
+
+/******************************************************************************/
+/* Recording */
+
+typedef struct table_entry {
+	struct table_entry *next;
+	uint32_t            hash;
+	uint32_t            bytes;
+	uint32_t            id;
+	void               *data;
+} table_entry_t;
+
+#define TABLE_BUCKETS (1024)
+
+static FILE *traceFile;
+static const char *tracePath;
+static table_entry_t *tableBuckets[TABLE_BUCKETS];
+static uint32_t tableCount;
+
+typedef struct {
+	const void *bits;
+	uint32_t    id;
+} surface_entry_t;
+
+static surface_entry_t *surfaces;
+static size_t surfaceCapacity;
+static uint32_t surfaceCount;
+
+static void writeWords(const uint32_t *words, size_t count)
+{
+	fwrite(words, sizeof *words, count, traceFile);
+}
+
+static uint32_t hashWords(const uint32_t *words, size_t count)
+{
+	uint32_t h = 0x811C9DC5;
+	for (size_t i = 0; i < count; i++)
+		h = (h ^ words[i]) * 0x01000193;
+	return h;
+}
+
+/* Return the number of a table with these contents, writing it out first if
+ * it hasn't been seen before. All tables are a whole number of words long. */
+static uint32_t tableId(const void *data, uint32_t bytes)
+{
+	if (data == NULL)
+		return 0;
+	uint32_t hash = hashWords(data, bytes / 4);
+	table_entry_t **bucket = &tableBuckets[hash % TABLE_BUCKETS];
+	for (table_entry_t *e = *bucket; e != NULL; e = e->next)
+		if (e->hash == hash && e->bytes == bytes && memcmp(e->data, data, bytes) == 0)
+			return e->id;
+	table_entry_t *e = malloc(sizeof *e);
+	void *copy = malloc(bytes);
+	if (e == NULL || copy == NULL) {
+		fprintf(stderr, "Out of memory recording BitBlt trace\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(copy, data, bytes);
+	e->next = *bucket;
+	e->hash = hash;
+	e->bytes = bytes;
+	e->id = ++tableCount;
+	e->data = copy;
+	*bucket = e;
+	uint32_t header[] = { TAG_TABLE, e->id, bytes };
+	writeWords(header, sizeof header / sizeof *header);
+	writeWords(data, bytes / 4);
+	return e->id;
+}
+
+static size_t surfaceSlot(const void *bits)
+{
+	size_t i = ((uintptr_t) bits >> 4) * 0x9E3779B1u;
+	for (;; i++) {
+		i &= surfaceCapacity - 1;
+		if (surfaces[i].bits == bits || surfaces[i].bits == NULL)
+			return i;
+	}
+}
+
+/* Surfaces are numbered in order of first appearance */
+static uint32_t surfaceId(const void *bits)
+{
+	if (surfaceCount * 2 >= surfaceCapacity) {
+		surface_entry_t *old = surfaces;
+		size_t oldCapacity = surfaceCapacity;
+		surfaceCapacity = oldCapacity == 0 ? 256 : oldCapacity * 2;
+		surfaces = calloc(surfaceCapacity, sizeof *surfaces);
+		if (surfaces == NULL) {
+			fprintf(stderr, "Out of memory recording BitBlt trace\n");
+			exit(EXIT_FAILURE);
+		}
+		for (size_t i = 0; i < oldCapacity; i++)
+			if (old[i].bits != NULL)
+				surfaces[surfaceSlot(old[i].bits)] = old[i];
+		free(old);
+	}
+	size_t i = surfaceSlot(bits);
+	if (surfaces[i].bits == NULL) {
+		surfaces[i].bits = bits;
+		surfaces[i].id = surfaceCount++;
+	}
+	return surfaces[i].id;
+}
+
+static void recordSurface(uint32_t *words, const src_or_dest_t *s)
+{
+	words[S_SURFACE] = surfaceId(s->bits);
+	words[S_DEPTH] = s->depth;
+	words[S_PITCH] = s->pitch;
+	words[S_MSB] = s->msb;
+	words[S_X] = s->x;
+	words[S_Y] = s->y;
+}
+
+bool bitBltTraceOpen(const char *path)
+{
+	static bool registered;
+	if (traceFile != NULL)
+		bitBltTraceClose();
+	traceFile = fopen(path, "wb");
+	if (traceFile == NULL) {
+		fprintf(stderr, "Unable to open %s for BitBlt trace\n", path);
+		return false;
+	}
+	tracePath = path;
+	if (!registered) {
+		atexit(bitBltTraceClose);
+		registered = true;
+	}
+	uint32_t header[] = { TRACE_MAGIC, TRACE_VERSION, TRACE_BYTE_ORDER };
+	writeWords(header, sizeof header / sizeof *header);
+	return true;
+}
+
+void bitBltTraceClose(void)
+{
+	if (traceFile == NULL)
+		return;
+	if (ferror(traceFile) | fclose(traceFile))
+		fprintf(stderr, "Error writing BitBlt trace to %s\n", tracePath);
+	traceFile = NULL;
+	for (size_t i = 0; i < TABLE_BUCKETS; i++) {
+		while (tableBuckets[i] != NULL) {
+			table_entry_t *e = tableBuckets[i];
+			tableBuckets[i] = e->next;
+			free(e->data);
+			free(e);
+		}
+	}
+	tableCount = 0;
+	free(surfaces);
+	surfaces = NULL;
+	surfaceCapacity = 0;
+	surfaceCount = 0;
+}
+
+bool bitBltTracing(void)
+{
+	return traceFile != NULL;
+}
+
+void bitBltTraceCopy(const operation_t *op)
+{
+	uint32_t words[1 + COPY_WORDS] = { TAG_COPY };
+	uint32_t *w = words + 1;
+	w[C_RULE] = op->combinationRule;
+	w[C_NO_SOURCE] = op->noSource;
+	if (op->noSource)
+		w[C_SRC + S_SURFACE] = TRACE_NO_SURFACE;
+	else
+		recordSurface(w + C_SRC, &op->src);
+	recordSurface(w + C_DEST, &op->dest);
+	w[C_WIDTH] = op->width;
+	w[C_HEIGHT] = op->height;
+	w[C_CM_FLAGS] = op->cmFlags;
+	w[C_CM_MASK] = op->cmMask;
+	if (op->cmFlags & ColorMapFixedPart) {
+		w[C_CM_MASK_TABLE] = tableId(op->cmMaskTable, sizeof *op->cmMaskTable);
+		w[C_CM_SHIFT_TABLE] = tableId(op->cmShiftTable, sizeof *op->cmShiftTable);
+	}
+	if (op->cmFlags & ColorMapIndexedPart)
+		w[C_CM_LOOKUP_TABLE] = tableId(op->cmLookupTable, (op->cmMask + 1) * sizeof **op->cmLookupTable);
+	w[C_NO_HALFTONE] = op->noHalftone;
+	if (!op->noHalftone) {
+		w[C_HALFTONE_HEIGHT] = op->halftoneHeight;
+		w[C_HALFTONE] = tableId(op->halftoneBase, op->halftoneHeight * sizeof **op->halftoneBase);
+	}
+	if (op->combinationRule == CR_rgbComponentAlpha) {
+		w[C_OPT_0] = op->opt.componentAlpha.componentAlphaModeColor;
+		w[C_OPT_1] = op->opt.componentAlpha.componentAlphaModeAlpha;
+		w[C_GAMMA] = tableId(op->opt.componentAlpha.gammaLookupTable, sizeof *op->opt.componentAlpha.gammaLookupTable);
+		w[C_UNGAMMA] = tableId(op->opt.componentAlpha.ungammaLookupTable, sizeof *op->opt.componentAlpha.ungammaLookupTable);
+	} else {
+		w[C_OPT_0] = op->opt.sourceAlpha;
+	}
+	writeWords(words, sizeof words / sizeof *words);
+}
+
+void bitBltTraceCompare(const compare_operation_t *op)
+{
+	uint32_t words[1 + COMPARE_WORDS] = { TAG_COMPARE };
+	uint32_t *w = words + 1;
+	w[M_MATCH_RULE] = op->matchRule;
+	w[M_TALLY] = op->tally;
+	recordSurface(w + M_SRC_A, &op->srcA);
+	recordSurface(w + M_SRC_B, &op->srcB);
+	w[M_WIDTH] = op->width;
+	w[M_HEIGHT] = op->height;
+	w[M_COLOR_A] = op->colorA;
+	w[M_COLOR_B] = op->colorB;
+	writeWords(words, sizeof words / sizeof *words);
+}
+
+/******************************************************************************/
+/* Loading */
+
+static void *grow(void *array, size_t *capacity, size_t needed, size_t size)
+{
+	if (needed <= *capacity)
+		return array;
+	size_t newCapacity = *capacity == 0 ? 256 : *capacity;
+	while (newCapacity < needed)
+		newCapacity *= 2;
+	array = realloc(array, newCapacity * size);
+	if (array == NULL) {
+		fprintf(stderr, "Out of memory loading BitBlt trace\n");
+		exit(EXIT_FAILURE);
+	}
+	memset((char *) array + *capacity * size, 0, (newCapacity - *capacity) * size);
+	*capacity = newCapacity;
+	return array;
+}
+
+typedef struct {
+	trace_t *trace;
+	size_t   recordCapacity;
+	size_t   surfaceCapacity;
+	size_t   tableCapacity;
+	bool     bad;
+	bool     truncated;
+} loader_t;
+
+static void *loadedTable(loader_t *l, uint32_t id)
+{
+	if (id == 0)
+		return NULL;
+	if (id >= l->trace->tableCount || l->trace->tables[id] == NULL) {
+		l->bad = true;
+		return NULL;
+	}
+	return l->trace->tables[id];
+}
+
+static uint32_t loadSurface(loader_t *l, src_or_dest_t *s, const uint32_t *words, uint32_t height)
+{
+	uint32_t id = words[S_SURFACE];
+	s->bits = NULL;
+	s->depth = words[S_DEPTH];
+	s->pitch = words[S_PITCH];
+	s->msb = words[S_MSB];
+	s->x = words[S_X];
+	s->y = words[S_Y];
+	trace_t *t = l->trace;
+	t->surfaceBytes = grow(t->surfaceBytes, &l->surfaceCapacity, (size_t) id + 1, sizeof *t->surfaceBytes);
+	if (t->surfaceCount <= id)
+		t->surfaceCount = (size_t) id + 1;
+	size_t bytes = (size_t) words[S_PITCH] * ((size_t) words[S_Y] + height);
+	if (t->surfaceBytes[id] < bytes)
+		t->surfaceBytes[id] = bytes;
+	return id;
+}
+
+static trace_record_t *newRecord(loader_t *l)
+{
+	trace_t *t = l->trace;
+	t->records = grow(t->records, &l->recordCapacity, t->count + 1, sizeof *t->records);
+	return &t->records[t->count++];
+}
+
+bool bitBltTraceLoad(const char *path, trace_t *trace)
+{
+	memset(trace, 0, sizeof *trace);
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) {
+		fprintf(stderr, "Unable to open %s\n", path);
+		return false;
+	}
+	uint32_t header[3];
+	if (fread(header, sizeof *header, 3, f) != 3 || header[0] != TRACE_MAGIC) {
+		fprintf(stderr, "%s is not a BitBlt trace\n", path);
+		fclose(f);
+		return false;
+	}
+	if (header[1] != TRACE_VERSION || header[2] != TRACE_BYTE_ORDER) {
+		fprintf(stderr, "%s is a BitBlt trace from an incompatible version or machine\n", path);
+		fclose(f);
+		return false;
+	}
+
+	loader_t l = { .trace = trace };
+	uint32_t tag;
+	while (!l.bad && !l.truncated && fread(&tag, sizeof tag, 1, f) == 1) {
+		uint32_t w[COPY_WORDS]; /* the longest record */
+		switch (tag) {
+		case TAG_TABLE:
+			if (fread(w, sizeof *w, 2, f) != 2) {
+				l.truncated = true;
+				break;
+			}
+			if (w[0] == 0) {
+				l.bad = true;
+				break;
+			}
+			trace->tables = grow(trace->tables, &l.tableCapacity, (size_t) w[0] + 1, sizeof *trace->tables);
+			if (trace->tableCount <= w[0])
+				trace->tableCount = (size_t) w[0] + 1;
+			free(trace->tables[w[0]]);
+			trace->tables[w[0]] = malloc(w[1] == 0 ? 1 : w[1]);
+			if (trace->tables[w[0]] == NULL) {
+				fprintf(stderr, "Out of memory loading BitBlt trace\n");
+				exit(EXIT_FAILURE);
+			}
+			if (fread(trace->tables[w[0]], 1, w[1], f) != w[1])
+				l.truncated = true;
+			break;
+
+		case TAG_COPY: {
+			if (fread(w, sizeof *w, COPY_WORDS, f) != COPY_WORDS) {
+				l.truncated = true;
+				break;
+			}
+			trace_record_t *r = newRecord(&l);
+			operation_t *op = &r->op.copy;
+			r->compare = false;
+			op->combinationRule = w[C_RULE];
+			op->noSource = w[C_NO_SOURCE];
+			op->width = w[C_WIDTH];
+			op->height = w[C_HEIGHT];
+			if (op->noSource) {
+				memset(&op->src, 0, sizeof op->src);
+				r->srcSurface = TRACE_NO_SURFACE;
+			} else {
+				r->srcSurface = loadSurface(&l, &op->src, w + C_SRC, w[C_HEIGHT]);
+			}
+			r->destSurface = loadSurface(&l, &op->dest, w + C_DEST, w[C_HEIGHT]);
+			op->cmFlags = w[C_CM_FLAGS];
+			op->cmMask = w[C_CM_MASK];
+			op->cmMaskTable = loadedTable(&l, w[C_CM_MASK_TABLE]);
+			op->cmShiftTable = loadedTable(&l, w[C_CM_SHIFT_TABLE]);
+			op->cmLookupTable = loadedTable(&l, w[C_CM_LOOKUP_TABLE]);
+			op->noHalftone = w[C_NO_HALFTONE];
+			op->halftoneHeight = w[C_HALFTONE_HEIGHT];
+			op->halftoneBase = loadedTable(&l, w[C_HALFTONE]);
+			if (op->combinationRule == CR_rgbComponentAlpha) {
+				op->opt.componentAlpha.componentAlphaModeColor = w[C_OPT_0];
+				op->opt.componentAlpha.componentAlphaModeAlpha = w[C_OPT_1];
+				op->opt.componentAlpha.gammaLookupTable = loadedTable(&l, w[C_GAMMA]);
+				op->opt.componentAlpha.ungammaLookupTable = loadedTable(&l, w[C_UNGAMMA]);
+			} else {
+				op->opt.sourceAlpha = w[C_OPT_0];
+			}
+			break;
+		}
+
+		case TAG_COMPARE: {
+			if (fread(w, sizeof *w, COMPARE_WORDS, f) != COMPARE_WORDS) {
+				l.truncated = true;
+				break;
+			}
+			trace_record_t *r = newRecord(&l);
+			compare_operation_t *op = &r->op.compare;
+			r->compare = true;
+			op->matchRule = w[M_MATCH_RULE];
+			op->tally = w[M_TALLY];
+			op->width = w[M_WIDTH];
+			op->height = w[M_HEIGHT];
+			op->colorA = w[M_COLOR_A];
+			op->colorB = w[M_COLOR_B];
+			r->srcSurface = loadSurface(&l, &op->srcA, w + M_SRC_A, w[M_HEIGHT]);
+			r->destSurface = loadSurface(&l, &op->srcB, w + M_SRC_B, w[M_HEIGHT]);
+			break;
+		}
+
+		default:
+			l.bad = true;
+			break;
+		}
+	}
+	fclose(f);
+	if (l.bad) {
+		fprintf(stderr, "%s is corrupt after %zu operations\n", path, trace->count);
+		bitBltTraceFree(trace);
+		return false;
+	}
+	/* A session that was killed can leave a partial record at the end */
+	if (l.truncated)
+		fprintf(stderr, "%s is truncated; using the first %zu operations\n", path, trace->count);
+	return true;
+}
+
+void bitBltTraceFree(trace_t *trace)
+{
+	for (size_t i = 0; i < trace->tableCount; i++)
+		free(trace->tables[i]);
+	free(trace->tables);
+	free(trace->records);
+	free(trace->surfaceBytes);
+	memset(trace, 0, sizeof *trace);
+}
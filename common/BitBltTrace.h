@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BITBLTTRACE_H_
+#define BITBLTTRACE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "BitBltDispatch.h"
+
+/* Binary traces of the operations passed to copyBitsDispatch() and
+ * compareColorsDispatch(), for replaying a real workload later.
+ *
+ * Recording happens in the BitBltStats interposer: set BITBLT_TRACE to the
+ * name of a file, or call bitBltTraceOpen(). Every operation is written out
+ * in full, including its geometry, colour map and halftone. The tables an
+ * operation points at are written once each, the first time their contents
+ * are seen, and referred to by number thereafter. Surfaces are identified
+ * by their base address only; their contents are not recorded.
+ *
+ * Traces are written in the host's byte order and are only meant to be
+ * replayed on a similar machine. */
+
+/* Start writing a trace. Returns false (having printed why) on failure. */
+bool bitBltTraceOpen(const char *path);
+
+/* Flush and close the trace; this is also done automatically at exit */
+void bitBltTraceClose(void);
+
+/* Called by the interposer for each operation while a trace is open */
+bool bitBltTracing(void);
+void bitBltTraceCopy(const operation_t *op);
+void bitBltTraceCompare(const compare_operation_t *op);
+
+/* A trace, as read back. The table pointers in each operation refer to
+ * memory owned by the trace. The surface pointers are left NULL; the
+ * caller should point them at buffers of at least surfaceBytes[] bytes for
+ * the surface numbers given, and must remember that noSource operations
+ * have no source surface. */
+#define TRACE_NO_SURFACE UINT32_MAX
+
+typedef struct {
+	bool                    compare;
+	uint32_t                srcSurface;
+	uint32_t                destSurface;
+	union {
+		operation_t         copy;
+		compare_operation_t compare;
+	} op;
+} trace_record_t;
+
+typedef struct {
+	trace_record_t *records;
+	size_t          count;
+	size_t         *surfaceBytes;
+	size_t          surfaceCount;
+	void          **tables;
+	size_t          tableCount;
+} trace_t;
+
+/* Read a trace. Returns false (having printed why) on failure. */
+bool bitBltTraceLoad(const char *path, trace_t *trace);
+
+void bitBltTraceFree(trace_t *trace);
+
+#endif /* BITBLTTRACE_H_ */
@@ -0,0 +1,237 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+/* Registration of the x86-64 fast paths. The CPU is probed once, and each
+ * fast path is installed in the best variant that the CPU can run. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "BitBltInternal.h"
+#include "BitBltX64.h"
+#include "BitBltX64Internal.h"
+
+#define FAST_PATH_NAME(name, rule, flags) #name,
+
+static const char *const fastPathNames[] = {
+	X64_FAST_PATHS(FAST_PATH_NAME)
+};
+
+#define FAST_PATH_COUNT (sizeof fastPathNames / sizeof *fastPathNames)
+
+static fast_path_t fastPaths[FAST_PATH_COUNT];
+static const char *fastPathIsa[FAST_PATH_COUNT];
+
+static bool cpuProbed;
+static bool haveAvx2;
+
+static void probeCpu(void)
+{
+	if (cpuProbed)
+		return;
+	cpuProbed = true;
+	__builtin_cpu_init();
+	haveAvx2 = __builtin_cpu_supports("avx2");
+	/* Allow a lower instruction set to be forced, for comparison purposes */
+	const char *isa = getenv("BITBLT_X64_ISA");
+	if (isa != NULL && strcmp(isa, "sse2") == 0)
+		haveAvx2 = false;
+}
+
+void addX64FastPaths(void)
+{
+	probeCpu();
+	for (size_t i = 0; i < FAST_PATH_COUNT; i++) {
+		if (haveAvx2 && x64FastPathsAvx2[i].func != NULL) {
+			fastPaths[i] = x64FastPathsAvx2[i];
+			fastPathIsa[i] = "avx2";
+		} else {
+			fastPaths[i] = x64FastPathsSse2[i];
+			fastPathIsa[i] = "sse2";
+		}
+	}
+	addFastPaths(fastPaths, FAST_PATH_COUNT);
+}
+
+static uint32_t srcDepthFlag(const operation_t *op)
+{
+	if (op->noSource)
+		return FAST_PATH_SRC_0BPP;
+	switch (op->src.depth) {
+	case 1:  return FAST_PATH_SRC_1BPP;
+	case 2:  return FAST_PATH_SRC_2BPP;
+	case 4:  return FAST_PATH_SRC_4BPP;
+	case 8:  return FAST_PATH_SRC_8BPP;
+	case 16: return FAST_PATH_SRC_16BPP;
+	case 32: return FAST_PATH_SRC_32BPP;
+	}
+	return 0;
+}
+
+static uint32_t destDepthFlag(const operation_t *op)
+{
+	switch (op->dest.depth) {
+	case 1:  return FAST_PATH_DEST_1BPP;
+	case 2:  return FAST_PATH_DEST_2BPP;
+	case 4:  return FAST_PATH_DEST_4BPP;
+	case 8:  return FAST_PATH_DEST_8BPP;
+	case 16: return FAST_PATH_DEST_16BPP;
+	case 32: return FAST_PATH_DEST_32BPP;
+	}
+	return 0;
+}
+
+/* This follows the dispatcher's rules, except that if extended is set,
+ * indexed lookup tables of up to 256 entries on sources of 8 bpp or less are
+ * given FAST_PATH_DIRECT_COLOR_MAP. The dispatcher gives those no colour map
+ * flag, so it can't select the expand kernels itself. */
+static uint32_t colorMapFlag(const operation_t *op, bool extended)
+{
+	if ((op->cmFlags & ColorMapPresent) == 0)
+		return FAST_PATH_NO_COLOR_MAP;
+	if ((op->cmFlags & ColorMapIndexedPart) == 0)
+		return FAST_PATH_DIRECT_COLOR_MAP;
+	switch (op->cmMask) {
+	case 0x1FF:  return FAST_PATH_9BIT_COLOR_MAP;
+	case 0xFFF:  return FAST_PATH_12BIT_COLOR_MAP;
+	case 0x7FFF: return FAST_PATH_15BIT_COLOR_MAP;
+	}
+	if (extended && (op->cmFlags & ColorMapFixedPart) == 0 && !op->noSource && op->src.depth <= 8 && op->cmMask <= 0xFF)
+		return FAST_PATH_DIRECT_COLOR_MAP;
+	return 0;
+}
+
+/* The fixed parts of colour maps that x64ColorMapPlan() recognises */
+static const struct {
+	uint32_t        masks[4];
+	int32_t         shifts[4];
+	x64_color_map_t plan;
+} knownColorMaps[] = {
+	{ { 0x7000,   0x0380,   0x001C,   0 }, {  -6,  -4, -2, 0 }, X64_CM_16_TO_9  },
+	{ { 0x7800,   0x03C0,   0x001E,   0 }, {  -3,  -2, -1, 0 }, X64_CM_16_TO_12 },
+	{ { 0x7C00,   0x03E0,   0x001F,   0 }, {   9,   6,  3, 0 }, X64_CM_16_TO_32 },
+	{ { 0xE00000, 0x00E000, 0x0000E0, 0 }, { -15, -10, -5, 0 }, X64_CM_32_TO_9  },
+	{ { 0xF00000, 0x00F000, 0x0000F0, 0 }, { -12,  -8, -4, 0 }, X64_CM_32_TO_12 },
+	{ { 0xF80000, 0x00F800, 0x0000F8, 0 }, {  -9,  -6, -3, 0 }, X64_CM_32_TO_15 },
+};
+
+x64_color_map_t x64ColorMapPlan(const operation_t *op)
+{
+	if ((op->cmFlags & ColorMapPresent) == 0)
+		return X64_CM_UNRECOGNISED;
+	if ((op->cmFlags & ColorMapFixedPart) == 0)
+		return X64_CM_NO_FIXED_PART;
+	for (size_t i = 0; i < sizeof knownColorMaps / sizeof *knownColorMaps; i++)
+		if (memcmp(*op->cmMaskTable, knownColorMaps[i].masks, sizeof knownColorMaps[i].masks) == 0 &&
+		    memcmp(*op->cmShiftTable, knownColorMaps[i].shifts, sizeof knownColorMaps[i].shifts) == 0)
+			return knownColorMaps[i].plan;
+	return X64_CM_UNRECOGNISED;
+}
+
+x64_lookup_shape_t x64LookupShape(const operation_t *op, uint32_t values[2])
+{
+	if ((op->cmFlags & ColorMapIndexedPart) == 0 || (uint64_t) op->cmMask + 1 > (uint64_t) op->width * op->height)
+		return X64_LOOKUP_GENERAL;
+	const uint32_t *lookup = *op->cmLookupTable;
+	values[0] = lookup[0];
+	values[1] = lookup[op->cmMask];
+	for (size_t i = 1; i < op->cmMask; i++)
+		if (lookup[i] != values[1])
+			return X64_LOOKUP_GENERAL;
+	return values[0] == values[1] ? X64_LOOKUP_CONSTANT : X64_LOOKUP_TWO_VALUED;
+}
+
+static uint32_t halftoneFlag(const operation_t *op)
+{
+	if (op->noHalftone)
+		return FAST_PATH_NO_HALFTONE;
+	return op->halftoneHeight == 1 ? FAST_PATH_SCALAR_HALFTONE : FAST_PATH_VECTOR_HALFTONE;
+}
+
+/* The colour-mapped kernels defer to the generic code, which isn't reentrant,
+ * for colour maps that they have no specialised kernel for. Those blits are
+ * reported as having no x86-64 fast path, so that the parallel and batched
+ * entry points never call such a kernel directly. */
+static bool colorMapHandled(const operation_t *op)
+{
+	if ((op->cmFlags & ColorMapPresent) == 0)
+		return true;
+	x64_color_map_t plan = x64ColorMapPlan(op);
+	if ((op->cmFlags & ColorMapIndexedPart) != 0)
+		return plan != X64_CM_UNRECOGNISED;
+	return plan == X64_CM_16_TO_32 || plan == X64_CM_32_TO_15;
+}
+
+static const fast_path_t *findFastPath(const operation_t *op, size_t *index)
+{
+	uint32_t required[] = {
+		srcDepthFlag(op),
+		op->noSource || op->src.msb ? FAST_PATH_SRC_BIG_ENDIAN : FAST_PATH_SRC_LITTLE_ENDIAN,
+		destDepthFlag(op),
+		op->dest.msb ? FAST_PATH_DEST_BIG_ENDIAN : FAST_PATH_DEST_LITTLE_ENDIAN,
+		colorMapFlag(op, true),
+		halftoneFlag(op),
+	};
+	if (!cpuProbed || !colorMapHandled(op))
+		return NULL;
+	for (size_t i = 0; i < FAST_PATH_COUNT; i++) {
+		if (fastPaths[i].combinationRule != op->combinationRule)
+			continue;
+		size_t j;
+		for (j = 0; j < sizeof required / sizeof *required; j++)
+			if ((fastPaths[i].flags & required[j]) == 0)
+				break;
+		if (j == sizeof required / sizeof *required) {
+			*index = i;
+			return &fastPaths[i];
+		}
+	}
+	return NULL;
+}
+
+bool x64DescribeFastPath(const operation_t *op, const char **name, const char **isa)
+{
+	size_t i;
+	if (findFastPath(op, &i) == NULL)
+		return false;
+	*name = fastPathNames[i];
+	*isa = fastPathIsa[i];
+	return true;
+}
+
+x64_kernel_t x64LookupFastPath(const operation_t *op)
+{
+	size_t i;
+	const fast_path_t *path = findFastPath(op, &i);
+	return path == NULL ? NULL : path->func;
+}
+
+x64_kernel_t x64LookupUndispatchedFastPath(const operation_t *op)
+{
+	if (colorMapFlag(op, false) != 0 || colorMapFlag(op, true) == 0)
+		return NULL;
+	return x64LookupFastPath(op);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BITBLTX64_H_
+#define BITBLTX64_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "BitBltDispatch.h"
+
+/* Register the x86-64 fast paths with the dispatcher. Call this after
+ * initialiseCopyBits() has installed the generic fast paths. */
+void addX64FastPaths(void);
+
+/* If copyBitsDispatch() would hand op to one of the x86-64 fast paths, return
+ * true and set name and isa to its kernel name and the instruction set
+ * variant chosen for it. This mirrors the dispatcher's matching closely
+ * enough for reporting, but isn't used for dispatch itself. */
+bool x64DescribeFastPath(const operation_t *op, const char **name, const char **isa);
+
+/* Return the x86-64 kernel that would handle op, or NULL if there isn't one.
+ * Unlike the generic code, these kernels keep no state outside of op, so they
+ * may be called concurrently on disjoint parts of a blit. Blits that a kernel
+ * would pass on to the generic code get NULL. */
+typedef void (*x64_kernel_t)(operation_t *op, uint32_t flags);
+x64_kernel_t x64LookupFastPath(const operation_t *op);
+
+/* As x64LookupFastPath(), but only for blits that the dispatcher in the VM
+ * tree has no flags to describe, and so can't hand to a fast path: those
+ * from sources of 8 bpp or less through an indexed-only colour map, which the
+ * expand kernels handle. The BitBltStats interposer calls these kernels
+ * itself, which is how copyBitsDispatch() reaches them in the harnesses. */
+x64_kernel_t x64LookupUndispatchedFastPath(const operation_t *op);
+
+#endif /* BITBLTX64_H_ */
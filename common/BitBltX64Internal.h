@@ -0,0 +1,147 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BITBLTX64INTERNAL_H_
+#define BITBLTX64INTERNAL_H_
+
+#include "BitBltInternal.h"
+
+/* The kernels apply any halftone to the source themselves, so they can accept
+ * STD_FLAGS(..., ANY) */
+#define FAST_PATH_ANY_HALFTONE \
+	(FAST_PATH_NO_HALFTONE | FAST_PATH_SCALAR_HALFTONE | FAST_PATH_VECTOR_HALFTONE)
+
+/* Every x86-64 fast path, as P(kernel name, combination rule, flags). Each
+ * instruction set variant provides a table with one entry per item here, in
+ * the same order, so that addX64FastPaths() can pick between them. */
+#define X64_BITWISE_FAST_PATHS(P, depth) \
+	P(clearWord,            CR_clearWord,            STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(destinationWord,      CR_destinationWord,      STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitInvertDestination, CR_bitInvertDestination, STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitAnd,               CR_bitAnd,               STD_FLAGS(depth,depth,NO,ANY)) \
+	P(bitAnd,               CR_bitAnd,               STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitAndInvert,         CR_bitAndInvert,         STD_FLAGS(depth,depth,NO,ANY)) \
+	P(bitAndInvert,         CR_bitAndInvert,         STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(sourceWord,           CR_sourceWord,           STD_FLAGS(depth,depth,NO,ANY)) \
+	P(sourceWord,           CR_sourceWord,           STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitInvertAnd,         CR_bitInvertAnd,         STD_FLAGS(depth,depth,NO,ANY)) \
+	P(bitInvertAnd,         CR_bitInvertAnd,         STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitXor,               CR_bitXor,               STD_FLAGS(depth,depth,NO,ANY)) \
+	P(bitXor,               CR_bitXor,               STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitOr,                CR_bitOr,                STD_FLAGS(depth,depth,NO,ANY)) \
+	P(bitOr,                CR_bitOr,                STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitInvertAndInvert,   CR_bitInvertAndInvert,   STD_FLAGS(depth,depth,NO,ANY)) \
+	P(bitInvertAndInvert,   CR_bitInvertAndInvert,   STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitInvertXor,         CR_bitInvertXor,         STD_FLAGS(depth,depth,NO,ANY)) \
+	P(bitInvertXor,         CR_bitInvertXor,         STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitOrInvert,          CR_bitOrInvert,          STD_FLAGS(depth,depth,NO,ANY)) \
+	P(bitOrInvert,          CR_bitOrInvert,          STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitInvertSource,      CR_bitInvertSource,      STD_FLAGS(depth,depth,NO,ANY)) \
+	P(bitInvertSource,      CR_bitInvertSource,      STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitInvertOr,          CR_bitInvertOr,          STD_FLAGS(depth,depth,NO,ANY)) \
+	P(bitInvertOr,          CR_bitInvertOr,          STD_FLAGS_NO_SOURCE(depth,ANY)) \
+	P(bitInvertOrInvert,    CR_bitInvertOrInvert,    STD_FLAGS(depth,depth,NO,ANY)) \
+	P(bitInvertOrInvert,    CR_bitInvertOrInvert,    STD_FLAGS_NO_SOURCE(depth,ANY))
+
+/* Fast paths for colour-mapped blits. These only take effect when
+ * x64ColorMapPlan() recognises the colour map, and an indexed part may be
+ * combined with any fixed part that it recognises. */
+#define X64_INDEXED_FLAGS(src) \
+	(STD_FLAGS(src,1,9BIT,ANY) | FAST_PATH_12BIT_COLOR_MAP | FAST_PATH_15BIT_COLOR_MAP | \
+	 FAST_PATH_DEST_2BPP | FAST_PATH_DEST_4BPP | FAST_PATH_DEST_8BPP | \
+	 FAST_PATH_DEST_16BPP | FAST_PATH_DEST_32BPP)
+
+/* alphaBlend needs the alpha channel of a 32 bpp destination */
+#define X64_INDEXED_TO_32_FLAGS \
+	(STD_FLAGS(16,32,9BIT,ANY) | FAST_PATH_12BIT_COLOR_MAP | FAST_PATH_15BIT_COLOR_MAP | \
+	 FAST_PATH_SRC_32BPP)
+
+/* Sources of 8 bpp or less index the lookup table directly. The dispatcher
+ * never asks for these flags, so these fast paths are called through
+ * x64LookupUndispatchedFastPath() instead. */
+#define X64_EXPAND_FLAGS \
+	(STD_FLAGS(1,32,DIRECT,ANY) | FAST_PATH_SRC_2BPP | FAST_PATH_SRC_4BPP | FAST_PATH_SRC_8BPP)
+
+#define X64_COLOR_MAP_FAST_PATHS(P) \
+	P(sourceWord_direct,    CR_sourceWord,           STD_FLAGS(16,32,DIRECT,ANY)) \
+	P(sourceWord_direct,    CR_sourceWord,           STD_FLAGS(32,16,DIRECT,ANY)) \
+	P(sourceWord_indexed,   CR_sourceWord,           X64_INDEXED_FLAGS(16)) \
+	P(sourceWord_indexed,   CR_sourceWord,           X64_INDEXED_FLAGS(32)) \
+	P(alphaBlend_direct,    CR_alphaBlend,           STD_FLAGS(16,32,DIRECT,ANY)) \
+	P(alphaBlend_indexed,   CR_alphaBlend,           X64_INDEXED_TO_32_FLAGS) \
+	P(sourceWord_expand,    CR_sourceWord,           X64_EXPAND_FLAGS) \
+	P(alphaBlend_expand,    CR_alphaBlend,           X64_EXPAND_FLAGS)
+
+#define X64_FAST_PATHS(P) \
+	X64_BITWISE_FAST_PATHS(P, 1) \
+	X64_BITWISE_FAST_PATHS(P, 2) \
+	X64_BITWISE_FAST_PATHS(P, 4) \
+	X64_BITWISE_FAST_PATHS(P, 8) \
+	X64_BITWISE_FAST_PATHS(P, 16) \
+	X64_BITWISE_FAST_PATHS(P, 32) \
+	P(alphaBlend_32_32,     CR_alphaBlend,           STD_FLAGS(32,32,NO,ANY)) \
+	P(pixPaint_8_8,         CR_pixPaint,             STD_FLAGS(8,8,NO,ANY)) \
+	P(pixPaint_16_16,       CR_pixPaint,             STD_FLAGS(16,16,NO,ANY)) \
+	P(pixPaint_32_32,       CR_pixPaint,             STD_FLAGS(32,32,NO,ANY)) \
+	X64_COLOR_MAP_FAST_PATHS(P)
+
+/* The fixed parts of colour maps that have specialised kernels, named after
+ * the source depth and the width of the pixel or index that they produce.
+ * The numbers in the comments are those of the mask and shift tables that
+ * the image uses for them. */
+typedef enum {
+	X64_CM_UNRECOGNISED,
+	X64_CM_NO_FIXED_PART,
+	X64_CM_16_TO_9,   /* 53 */
+	X64_CM_16_TO_12,  /* 54 */
+	X64_CM_16_TO_32,  /* 58 */
+	X64_CM_32_TO_9,   /* 83 */
+	X64_CM_32_TO_12,  /* 84 */
+	X64_CM_32_TO_15,  /* 85 */
+} x64_color_map_t;
+
+/* Identify the colour map of op from the contents of its mask and shift
+ * tables, so the result remains correct if the tables are edited between
+ * blits and there is nothing to invalidate. This is done once per blit rather
+ * than once per pixel, and keeps no state, so it's safe to call concurrently. */
+x64_color_map_t x64ColorMapPlan(const operation_t *op);
+
+/* Lookup tables which collapse to one or two distinct values */
+typedef enum {
+	X64_LOOKUP_GENERAL,
+	X64_LOOKUP_CONSTANT,    /* every index maps to values[0] */
+	X64_LOOKUP_TWO_VALUED,  /* index 0 maps to values[0], all others to values[1] */
+} x64_lookup_shape_t;
+
+/* Classify the lookup table of op, from the entries that its cmMask can
+ * select. As with x64ColorMapPlan(), this goes by the table's contents, not
+ * its address, since the table may be edited, or moved and its memory reused,
+ * between blits. Tables larger than the blit itself aren't worth examining
+ * and are reported as general. */
+x64_lookup_shape_t x64LookupShape(const operation_t *op, uint32_t values[2]);
+
+extern fast_path_t x64FastPathsSse2[];
+extern fast_path_t x64FastPathsAvx2[];
+
+#endif /* BITBLTX64INTERNAL_H_ */
@@ -0,0 +1,786 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+/* Kernel templates for the x86-64 fast paths. This file is included once per
+ * instruction set by BitBltX64Sse2.c and BitBltX64Avx2.c, which define
+ * VECTOR_BYTES and X64_FAST_PATH_TABLE beforehand. The kernels use GCC's
+ * generic vector extensions rather than intrinsics (apart from AVX2 gathers),
+ * so the same source yields SSE2 or AVX2 code depending upon the target of the
+ * including file.
+ *
+ * All fast paths here handle big-endian pixel order. Any halftone is applied
+ * to the source as it's read, using the pattern word for each destination
+ * row repeated across a vector, so halftoned blits run the same loops as
+ * plain ones. Most
+ * also require equal source and destination depths and no colour map; their
+ * pixels are processed a whole 32-bit word at a time, with the source
+ * realigned to the destination using a funnel shift when their sub-word
+ * phases differ. Overlapping blits within the same form are handled by
+ * choosing the row and word order. The colour-mapped fast paths instead
+ * convert pixels individually or in groups, using a kernel specialised for
+ * the colour map that x64ColorMapPlan() identified. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#if VECTOR_BYTES == 32
+#include <immintrin.h>
+#endif
+
+#include "BitBltInternal.h"
+#include "BitBltX64Internal.h"
+
+#define VECTOR_WORDS (VECTOR_BYTES / 4)
+
+typedef uint32_t vec32_t __attribute__((vector_size(VECTOR_BYTES)));
+typedef uint16_t vec16_t __attribute__((vector_size(VECTOR_BYTES)));
+typedef uint8_t  vec8_t  __attribute__((vector_size(VECTOR_BYTES)));
+/* For unaligned loads and stores */
+typedef uint32_t vec32u_t __attribute__((vector_size(VECTOR_BYTES), aligned(4), may_alias));
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+typedef uint32_t (*scalar_merge_t)(uint32_t src, uint32_t dest);
+typedef vec32_t  (*vector_merge_t)(vec32_t src, vec32_t dest);
+
+/******************************************************************************/
+
+/* The bitwise rules work identically on scalars and vectors */
+#define DEFINE_BITWISE(name, expr)                                            \
+static ALWAYS_INLINE uint32_t name##_scalar(uint32_t s, uint32_t d)          \
+{                                                                             \
+	(void) s;                                                                 \
+	(void) d;                                                                 \
+	return expr;                                                              \
+}                                                                             \
+static ALWAYS_INLINE vec32_t name##_vector(vec32_t s, vec32_t d)             \
+{                                                                             \
+	(void) s;                                                                 \
+	(void) d;                                                                 \
+	return expr;                                                              \
+}
+
+DEFINE_BITWISE(clearWord,            s ^ s)
+DEFINE_BITWISE(bitAnd,               s & d)
+DEFINE_BITWISE(bitAndInvert,         s & ~d)
+DEFINE_BITWISE(sourceWord,           s)
+DEFINE_BITWISE(bitInvertAnd,         ~s & d)
+DEFINE_BITWISE(destinationWord,      d)
+DEFINE_BITWISE(bitXor,               s ^ d)
+DEFINE_BITWISE(bitOr,                s | d)
+DEFINE_BITWISE(bitInvertAndInvert,   ~s & ~d)
+DEFINE_BITWISE(bitInvertXor,         ~s ^ d)
+DEFINE_BITWISE(bitInvertDestination, ~d)
+DEFINE_BITWISE(bitOrInvert,          s | ~d)
+DEFINE_BITWISE(bitInvertSource,      ~s)
+DEFINE_BITWISE(bitInvertOr,          ~s | d)
+DEFINE_BITWISE(bitInvertOrInvert,    ~s | ~d)
+
+/* pixPaint: each destination pixel is replaced by the source pixel unless the
+ * source pixel is 0 */
+static ALWAYS_INLINE uint32_t pixPaint_scalar(uint32_t s, uint32_t d, uint32_t depth)
+{
+	uint32_t pixMask = depth == 32 ? 0xFFFFFFFFu : (1u << depth) - 1;
+	uint32_t zeroes = 0;
+	for (uint32_t shift = 0; shift < 32; shift += depth)
+		if (((s >> shift) & pixMask) == 0)
+			zeroes |= pixMask << shift;
+	return s | (d & zeroes);
+}
+
+static ALWAYS_INLINE uint32_t pixPaint8_scalar(uint32_t s, uint32_t d)
+{
+	return pixPaint_scalar(s, d, 8);
+}
+
+static ALWAYS_INLINE uint32_t pixPaint16_scalar(uint32_t s, uint32_t d)
+{
+	return pixPaint_scalar(s, d, 16);
+}
+
+static ALWAYS_INLINE uint32_t pixPaint32_scalar(uint32_t s, uint32_t d)
+{
+	return s == 0 ? d : s;
+}
+
+static ALWAYS_INLINE vec32_t pixPaint8_vector(vec32_t s, vec32_t d)
+{
+	return s | (d & (vec32_t) ((vec8_t) s == 0));
+}
+
+static ALWAYS_INLINE vec32_t pixPaint16_vector(vec32_t s, vec32_t d)
+{
+	return s | (d & (vec32_t) ((vec16_t) s == 0));
+}
+
+static ALWAYS_INLINE vec32_t pixPaint32_vector(vec32_t s, vec32_t d)
+{
+	return s | (d & (vec32_t) (s == 0));
+}
+
+/* alphaBlend: the source has 255*alpha in its top 8 bits. Each of the four
+ * channels is computed as (src*alpha + dest*(255-alpha) + 254) / 255, using
+ * the same shift-and-add approximation of division by 255 as the plugin. */
+static ALWAYS_INLINE uint32_t alphaBlend32_scalar(uint32_t s, uint32_t d)
+{
+	uint32_t alpha = s >> 24;
+	if (alpha == 0)
+		return d;
+	if (alpha == 255)
+		return s;
+	uint32_t unAlpha = 255 - alpha;
+	uint32_t blendRB = (s & 0xFF00FF) * alpha + (d & 0xFF00FF) * unAlpha + 0xFF00FF;
+	uint32_t blendAG = (((s >> 8) | 0xFF0000) & 0xFF00FF) * alpha + ((d >> 8) & 0xFF00FF) * unAlpha + 0xFF00FF;
+	blendRB = ((blendRB + (((blendRB - 0x10001) >> 8) & 0xFF00FF)) >> 8) & 0xFF00FF;
+	blendAG = ((blendAG + (((blendAG - 0x10001) >> 8) & 0xFF00FF)) >> 8) & 0xFF00FF;
+	return blendRB | (blendAG << 8);
+}
+
+static ALWAYS_INLINE vec32_t alphaBlend32_vector(vec32_t s, vec32_t d)
+{
+	/* Each 16-bit lane holds one channel of one pixel, so none of the
+	 * intermediate values can overflow into its neighbour */
+	vec32_t alpha = s >> 24;
+	vec16_t alpha16 = (vec16_t) (alpha | (alpha << 16));
+	vec16_t unAlpha16 = 255 - alpha16;
+	vec16_t blendRB = (vec16_t) (s & 0xFF00FF) * alpha16 + (vec16_t) (d & 0xFF00FF) * unAlpha16 + 0xFF;
+	vec16_t blendAG = (vec16_t) (((s >> 8) | 0xFF0000) & 0xFF00FF) * alpha16 + (vec16_t) ((d >> 8) & 0xFF00FF) * unAlpha16 + 0xFF;
+	blendRB = (blendRB + ((blendRB - 1) >> 8)) >> 8;
+	blendAG = (blendAG + ((blendAG - 1) >> 8)) >> 8;
+	vec32_t result = (vec32_t) blendRB | ((vec32_t) blendAG << 8);
+	vec32_t transparent = (vec32_t) (alpha == 0);
+	vec32_t opaque = (vec32_t) (alpha == 255);
+	return (result & ~(transparent | opaque)) | (d & transparent) | (s & opaque);
+}
+
+/******************************************************************************/
+
+static ALWAYS_INLINE vec32_t loadVector(const uint32_t *p)
+{
+	return *(const vec32u_t *) p;
+}
+
+static ALWAYS_INLINE void storeVector(uint32_t *p, vec32_t v)
+{
+	*(vec32u_t *) p = v;
+}
+
+/* Fetch a source word which may lie outside the words occupied by the source
+ * rectangle on this row; those words aren't guaranteed to be addressable, and
+ * any bits they would contribute are masked out of the result anyway. */
+static ALWAYS_INLINE uint32_t fetchGuarded(const uint32_t *src, intptr_t index, intptr_t first, intptr_t last)
+{
+	return index >= first && index <= last ? src[index] : 0;
+}
+
+static ALWAYS_INLINE void mergeEdge(uint32_t *dest, intptr_t w, uint32_t s, uint32_t mask, scalar_merge_t scalar)
+{
+	uint32_t d = dest[w];
+	dest[w] = (scalar(s, d) & mask) | (d & ~mask);
+}
+
+/* The halftone pattern word for destination row y, which is ANDed with each
+ * source word (or with all ones if there's no source) before merging */
+static ALWAYS_INLINE uint32_t halftoneWord(const operation_t *op, size_t y)
+{
+	return op->noHalftone ? 0xFFFFFFFFu : (*op->halftoneBase)[y % op->halftoneHeight];
+}
+
+static ALWAYS_INLINE void blit(operation_t *op, bool halftone, scalar_merge_t scalar, vector_merge_t vector)
+{
+	uint32_t depth = op->dest.depth;
+	size_t width = op->width;
+	size_t height = op->height;
+	bool noSource = op->noSource;
+	uint32_t *destBits = op->dest.bits;
+	size_t destPitch = op->dest.pitch / 4;
+	const uint32_t *srcBits = noSource ? NULL : op->src.bits;
+	size_t srcPitch = noSource ? 0 : op->src.pitch / 4;
+
+	/* Destination word extent and edge masks, with pixel 0 in the MS bits */
+	size_t destBitStart = op->dest.x * depth;
+	size_t destBitEnd = destBitStart + width * depth;
+	intptr_t firstWord = destBitStart >> 5;
+	intptr_t lastWord = (destBitEnd - 1) >> 5;
+	uint32_t firstMask = 0xFFFFFFFFu >> (destBitStart & 31);
+	uint32_t lastMask = 0xFFFFFFFFu << (31 - ((destBitEnd - 1) & 31));
+	if (firstWord == lastWord)
+		firstMask = lastMask = firstMask & lastMask;
+
+	/* Source word w+skewWords (shifted left by skewBits) and its successor
+	 * (shifted right) make up the source for destination word w */
+	size_t srcBitStart = noSource ? 0 : op->src.x * depth;
+	intptr_t delta = (intptr_t) srcBitStart - (intptr_t) destBitStart;
+	intptr_t skewWords = delta >> 5;
+	uint32_t skewBits = delta & 31;
+	intptr_t srcFirstWord = srcBitStart >> 5;
+	intptr_t srcLastWord = (srcBitStart + width * depth - 1) >> 5;
+
+	/* Range of words which are wholly overwritten */
+	intptr_t fullFirst = firstWord + (firstMask != 0xFFFFFFFFu);
+	intptr_t fullLast = lastWord - (lastMask != 0xFFFFFFFFu);
+
+	/* Choose a safe order when source and destination overlap */
+	bool reverseRows = false, reverseWords = false;
+	if (!noSource && op->src.bits == op->dest.bits) {
+		if (op->src.y < op->dest.y)
+			reverseRows = true;
+		else if (op->src.y == op->dest.y && delta < 0)
+			reverseWords = true;
+	}
+
+	for (size_t i = 0; i < height; i++) {
+		size_t row = reverseRows ? height - 1 - i : i;
+		uint32_t *dest = destBits + (op->dest.y + row) * destPitch;
+		const uint32_t *src = noSource ? NULL : srcBits + (op->src.y + row) * srcPitch + skewWords;
+		uint32_t ht = halftone ? halftoneWord(op, op->dest.y + row) : 0xFFFFFFFFu;
+		vec32_t htVector = (vec32_t) {} + ht;
+		intptr_t srcFirst = srcFirstWord - skewWords;
+		intptr_t srcLast = srcLastWord - skewWords;
+
+#define SOURCE_EDGE(w) (noSource ? 0xFFFFFFFFu : skewBits == 0 ? \
+		fetchGuarded(src, w, srcFirst, srcLast) : \
+		(fetchGuarded(src, w, srcFirst, srcLast) << skewBits) | (fetchGuarded(src, (w) + 1, srcFirst, srcLast) >> (32 - skewBits)))
+#define SOURCE_WORD(w) (noSource ? 0xFFFFFFFFu : skewBits == 0 ? src[w] : \
+		(src[w] << skewBits) | (src[(w) + 1] >> (32 - skewBits)))
+#define SOURCE_VECTOR(w) (noSource ? (vec32_t) {} - 1 : skewBits == 0 ? loadVector(src + (w)) : \
+		(loadVector(src + (w)) << skewBits) | (loadVector(src + (w) + 1) >> (32 - skewBits)))
+
+		if (!reverseWords) {
+			if (fullFirst != firstWord)
+				mergeEdge(dest, firstWord, SOURCE_EDGE(firstWord) & ht, firstMask, scalar);
+			intptr_t w = fullFirst;
+			for (; w + VECTOR_WORDS - 1 <= fullLast; w += VECTOR_WORDS)
+				storeVector(dest + w, vector(SOURCE_VECTOR(w) & htVector, loadVector(dest + w)));
+			for (; w <= fullLast; w++)
+				dest[w] = scalar(SOURCE_WORD(w) & ht, dest[w]);
+			if (fullLast != lastWord && lastWord != firstWord)
+				mergeEdge(dest, lastWord, SOURCE_EDGE(lastWord) & ht, lastMask, scalar);
+		} else {
+			if (fullLast != lastWord)
+				mergeEdge(dest, lastWord, SOURCE_EDGE(lastWord) & ht, lastMask, scalar);
+			intptr_t w = fullLast + 1;
+			for (; w - VECTOR_WORDS >= fullFirst; ) {
+				w -= VECTOR_WORDS;
+				storeVector(dest + w, vector(SOURCE_VECTOR(w) & htVector, loadVector(dest + w)));
+			}
+			while (--w >= fullFirst)
+				dest[w] = scalar(SOURCE_WORD(w) & ht, dest[w]);
+			if (fullFirst != firstWord && lastWord != firstWord)
+				mergeEdge(dest, firstWord, SOURCE_EDGE(firstWord) & ht, firstMask, scalar);
+		}
+#undef SOURCE_EDGE
+#undef SOURCE_WORD
+#undef SOURCE_VECTOR
+	}
+}
+
+/******************************************************************************/
+
+/* The fixed part of each colour map that x64ColorMapPlan() recognises, with
+ * the contents of its mask and shift tables built in. As in the plugin, a
+ * non-zero pixel never maps to 0, to avoid introducing transparency. */
+static ALWAYS_INLINE uint32_t fixedColorMapResult(uint32_t p, uint32_t pv)
+{
+	return pv == 0 && p != 0 ? 1 : pv;
+}
+
+static ALWAYS_INLINE uint32_t noFixedPart_map(uint32_t p)
+{
+	return p;
+}
+
+static ALWAYS_INLINE uint32_t map16to9_map(uint32_t p)
+{
+	return fixedColorMapResult(p, ((p & 0x7000) >> 6) | ((p & 0x0380) >> 4) | ((p & 0x001C) >> 2));
+}
+
+static ALWAYS_INLINE uint32_t map16to12_map(uint32_t p)
+{
+	return fixedColorMapResult(p, ((p & 0x7800) >> 3) | ((p & 0x03C0) >> 2) | ((p & 0x001E) >> 1));
+}
+
+static ALWAYS_INLINE uint32_t map16to32_map(uint32_t p)
+{
+	return fixedColorMapResult(p, ((p & 0x7C00) << 9) | ((p & 0x03E0) << 6) | ((p & 0x001F) << 3));
+}
+
+static ALWAYS_INLINE uint32_t map32to9_map(uint32_t p)
+{
+	return fixedColorMapResult(p, ((p & 0xE00000) >> 15) | ((p & 0x00E000) >> 10) | ((p & 0x0000E0) >> 5));
+}
+
+static ALWAYS_INLINE uint32_t map32to12_map(uint32_t p)
+{
+	return fixedColorMapResult(p, ((p & 0xF00000) >> 12) | ((p & 0x00F000) >> 8) | ((p & 0x0000F0) >> 4));
+}
+
+static ALWAYS_INLINE uint32_t map32to15_map(uint32_t p)
+{
+	return fixedColorMapResult(p, ((p & 0xF80000) >> 9) | ((p & 0x00F800) >> 6) | ((p & 0x0000F8) >> 3));
+}
+
+/* Vector equivalents of the fixed parts for direct 16 <-> 32 bpp blits */
+static ALWAYS_INLINE vec32_t fixedColorMapResult_vector(vec32_t p, vec32_t pv)
+{
+	return pv | ((vec32_t) (pv == 0) & (vec32_t) (p != 0) & 1);
+}
+
+static ALWAYS_INLINE vec32_t map16to32_vector(vec32_t p)
+{
+	return fixedColorMapResult_vector(p, ((p & 0x7C00) << 9) | ((p & 0x03E0) << 6) | ((p & 0x001F) << 3));
+}
+
+static ALWAYS_INLINE vec32_t map32to15_vector(vec32_t p)
+{
+	return fixedColorMapResult_vector(p, ((p & 0xF80000) >> 9) | ((p & 0x00F800) >> 6) | ((p & 0x0000F8) >> 3));
+}
+
+/* Shuffle masks for splitting and joining 16 bpp pixel pairs */
+#if VECTOR_WORDS == 4
+#define INTERLEAVE_LOW  ((vec32_t) { 0, 4, 1, 5 })
+#define INTERLEAVE_HIGH ((vec32_t) { 2, 6, 3, 7 })
+#define EVEN_LANES      ((vec32_t) { 0, 2, 4, 6 })
+#define ODD_LANES       ((vec32_t) { 1, 3, 5, 7 })
+#define PIXEL8_SHIFTS   ((vec32_t) { 24, 16, 8, 0 })
+#elif VECTOR_WORDS == 8
+#define INTERLEAVE_LOW  ((vec32_t) { 0, 8, 1, 9, 2, 10, 3, 11 })
+#define INTERLEAVE_HIGH ((vec32_t) { 4, 12, 5, 13, 6, 14, 7, 15 })
+#define EVEN_LANES      ((vec32_t) { 0, 2, 4, 6, 8, 10, 12, 14 })
+#define ODD_LANES       ((vec32_t) { 1, 3, 5, 7, 9, 11, 13, 15 })
+#define PIXEL8_SHIFTS   ((vec32_t) { 24, 16, 8, 0, 24, 16, 8, 0 })
+#endif
+
+typedef uint32_t (*color_map_t)(uint32_t p);
+
+/* Convert source pixel x of a row through map and, if indexed is set, the
+ * lookup table */
+static ALWAYS_INLINE uint32_t convertPixel(const uint32_t *src, size_t x, uint32_t srcDepth, color_map_t map, bool indexed, const uint32_t *lookup, uint32_t cmMask)
+{
+	uint32_t p = srcDepth == 32 ? src[x] : (src[x >> 1] >> (~x & 1) * 16) & 0xFFFF;
+	uint32_t pv = map(p);
+	if (indexed)
+		pv = lookup[pv & cmMask];
+	return pv;
+}
+
+/* Blit with a colour map, for 16 or 32 bpp sources and any destination depth.
+ * Each source pixel is passed through map and then, if indexed is set,
+ * through the lookup table, and the results are packed into destination
+ * words for merging. Overlapping blits within the same form are handled as
+ * in blit(), except that a row whose destination lies to the right of its
+ * source is converted and merged a pixel at a time from the right. */
+static ALWAYS_INLINE void convertBlit(operation_t *op, color_map_t map, bool indexed, scalar_merge_t scalar)
+{
+	uint32_t srcDepth = op->src.depth;
+	uint32_t depth = op->dest.depth;
+	uint32_t pixMask = depth == 32 ? 0xFFFFFFFFu : (1u << depth) - 1;
+	const uint32_t *lookup = indexed ? *op->cmLookupTable : NULL;
+	uint32_t cmMask = op->cmMask;
+	size_t width = op->width;
+	size_t height = op->height;
+	size_t destPitch = op->dest.pitch / 4;
+	size_t srcPitch = op->src.pitch / 4;
+
+	size_t destBitStart = op->dest.x * depth;
+	size_t destBitEnd = destBitStart + width * depth;
+	intptr_t firstWord = destBitStart >> 5;
+	intptr_t lastWord = (destBitEnd - 1) >> 5;
+	uint32_t firstMask = 0xFFFFFFFFu >> (destBitStart & 31);
+	uint32_t lastMask = 0xFFFFFFFFu << (31 - ((destBitEnd - 1) & 31));
+	if (firstWord == lastWord)
+		firstMask = lastMask = firstMask & lastMask;
+
+	/* Choose a safe order when source and destination overlap */
+	bool reverseRows = false, reversePixels = false;
+	if (op->src.bits == op->dest.bits) {
+		if (op->src.y < op->dest.y)
+			reverseRows = true;
+		else if (op->src.y == op->dest.y && op->src.x * srcDepth < destBitStart)
+			reversePixels = true;
+	}
+
+	for (size_t i = 0; i < height; i++) {
+		size_t row = reverseRows ? height - 1 - i : i;
+		uint32_t *dest = (uint32_t *) op->dest.bits + (op->dest.y + row) * destPitch;
+		const uint32_t *src = (const uint32_t *) op->src.bits + (op->src.y + row) * srcPitch;
+		uint32_t ht = halftoneWord(op, op->dest.y + row);
+		if (reversePixels) {
+			size_t bit = destBitEnd;
+			for (size_t x = op->src.x + width; x-- > op->src.x; ) {
+				bit -= depth;
+				uint32_t pv = convertPixel(src, x, srcDepth, map, indexed, lookup, cmMask);
+				uint32_t shift = 32 - depth - (bit & 31);
+				mergeEdge(dest, bit >> 5, ((pv & pixMask) << shift) & ht, pixMask << shift, scalar);
+			}
+			continue;
+		}
+		intptr_t w = firstWord;
+		uint32_t mask = firstMask;
+		uint32_t bits = 0;
+		uint32_t bitPos = destBitStart & 31;
+		for (size_t x = op->src.x, end = x + width; x < end; x++) {
+			uint32_t pv = convertPixel(src, x, srcDepth, map, indexed, lookup, cmMask);
+			bitPos += depth;
+			bits |= (pv & pixMask) << (32 - bitPos);
+			if (bitPos == 32) {
+				if (w == lastWord)
+					mask &= lastMask;
+				mergeEdge(dest, w, bits & ht, mask, scalar);
+				w++;
+				mask = 0xFFFFFFFFu;
+				bits = 0;
+				bitPos = 0;
+			}
+		}
+		if (bitPos != 0)
+			mergeEdge(dest, w, bits & ht, lastMask, scalar);
+	}
+}
+
+/* Blit from 16 to 32 bpp through the 58 colour map. Each source vector holds
+ * two vectors' worth of pixels, which are split into the upper and lower
+ * halves of each word, converted, and interleaved again. */
+static ALWAYS_INLINE void blitMap16to32(operation_t *op, scalar_merge_t scalar, vector_merge_t vector)
+{
+	size_t width = op->width;
+	size_t height = op->height;
+	size_t destPitch = op->dest.pitch / 4;
+	size_t srcPitch = op->src.pitch / 4;
+	bool odd = op->src.x & 1;
+
+	for (size_t row = 0; row < height; row++) {
+		uint32_t *dest = (uint32_t *) op->dest.bits + (op->dest.y + row) * destPitch + op->dest.x;
+		const uint32_t *src = (const uint32_t *) op->src.bits + (op->src.y + row) * srcPitch + (op->src.x >> 1);
+		uint32_t ht = halftoneWord(op, op->dest.y + row);
+		vec32_t htVector = (vec32_t) {} + ht;
+		size_t x = 0;
+		for (; x + 2 * VECTOR_WORDS <= width; x += 2 * VECTOR_WORDS) {
+			const uint32_t *s = src + x / 2;
+			vec32_t pairs = odd ? (loadVector(s) << 16) | (loadVector(s + 1) >> 16) : loadVector(s);
+			vec32_t high = map16to32_vector(pairs >> 16) & htVector;
+			vec32_t low = map16to32_vector(pairs & 0xFFFF) & htVector;
+			storeVector(dest + x, vector(__builtin_shuffle(high, low, INTERLEAVE_LOW), loadVector(dest + x)));
+			storeVector(dest + x + VECTOR_WORDS,
+					vector(__builtin_shuffle(high, low, INTERLEAVE_HIGH), loadVector(dest + x + VECTOR_WORDS)));
+		}
+		for (; x < width; x++) {
+			size_t sx = x + odd;
+			dest[x] = scalar(map16to32_map((src[sx >> 1] >> (~sx & 1) * 16) & 0xFFFF) & ht, dest[x]);
+		}
+	}
+}
+
+/* Fetch the pixel pair for 16 bpp destination word w, given the source
+ * pixels aligned so that src[i] is the source of destination pixel i, and
+ * leaving out any pixel outside the range first..last */
+static ALWAYS_INLINE uint32_t fetchMap32to16(const uint32_t *src, intptr_t w, intptr_t first, intptr_t last)
+{
+	intptr_t x = 2 * w;
+	return (x >= first && x <= last ? map32to15_map(src[x]) << 16 : 0) |
+	       (x + 1 >= first && x + 1 <= last ? map32to15_map(src[x + 1]) : 0);
+}
+
+/* Blit from 32 to 16 bpp through the 85 colour map. Two source vectors are
+ * converted and their even and odd lanes joined into pixel pairs. */
+static ALWAYS_INLINE void blitMap32to16(operation_t *op, scalar_merge_t scalar, vector_merge_t vector)
+{
+	size_t width = op->width;
+	size_t height = op->height;
+	size_t destPitch = op->dest.pitch / 4;
+	size_t srcPitch = op->src.pitch / 4;
+	intptr_t first = op->dest.x;
+	intptr_t last = first + width - 1;
+
+	size_t destBitStart = op->dest.x * 16;
+	size_t destBitEnd = destBitStart + width * 16;
+	intptr_t firstWord = destBitStart >> 5;
+	intptr_t lastWord = (destBitEnd - 1) >> 5;
+	uint32_t firstMask = 0xFFFFFFFFu >> (destBitStart & 31);
+	uint32_t lastMask = 0xFFFFFFFFu << (31 - ((destBitEnd - 1) & 31));
+	if (firstWord == lastWord)
+		firstMask = lastMask = firstMask & lastMask;
+	intptr_t fullFirst = firstWord + (firstMask != 0xFFFFFFFFu);
+	intptr_t fullLast = lastWord - (lastMask != 0xFFFFFFFFu);
+
+	for (size_t row = 0; row < height; row++) {
+		uint32_t *dest = (uint32_t *) op->dest.bits + (op->dest.y + row) * destPitch;
+		const uint32_t *src = (const uint32_t *) op->src.bits + (op->src.y + row) * srcPitch +
+				((intptr_t) op->src.x - (intptr_t) op->dest.x);
+		uint32_t ht = halftoneWord(op, op->dest.y + row);
+		vec32_t htVector = (vec32_t) {} + ht;
+		if (fullFirst != firstWord)
+			mergeEdge(dest, firstWord, fetchMap32to16(src, firstWord, first, last) & ht, firstMask, scalar);
+		intptr_t w = fullFirst;
+		for (; w + VECTOR_WORDS - 1 <= fullLast; w += VECTOR_WORDS) {
+			vec32_t a = map32to15_vector(loadVector(src + 2 * w));
+			vec32_t b = map32to15_vector(loadVector(src + 2 * w + VECTOR_WORDS));
+			vec32_t pairs = (__builtin_shuffle(a, b, EVEN_LANES) << 16) | __builtin_shuffle(a, b, ODD_LANES);
+			storeVector(dest + w, vector(pairs & htVector, loadVector(dest + w)));
+		}
+		for (; w <= fullLast; w++)
+			dest[w] = scalar(((map32to15_map(src[2 * w]) << 16) | map32to15_map(src[2 * w + 1])) & ht, dest[w]);
+		if (fullLast != lastWord && lastWord != firstWord)
+			mergeEdge(dest, lastWord, fetchMap32to16(src, lastWord, first, last) & ht, lastMask, scalar);
+	}
+}
+
+#if VECTOR_BYTES == 32
+static ALWAYS_INLINE vec32_t gatherVector(const uint32_t *table, vec32_t index)
+{
+	return (vec32_t) _mm256_i32gather_epi32((const int *) table, (__m256i) index, 4);
+}
+#endif
+
+/* Load the words holding a vector's worth of 8 bpp pixels, starting at a word
+ * boundary, with each word repeated in the lanes of its four pixels. Pixel i
+ * of the vector is then (words >> PIXEL8_SHIFTS[i]) & 0xFF. */
+static ALWAYS_INLINE vec32_t loadPixels8(const uint32_t *src)
+{
+#if VECTOR_WORDS == 4
+	return (vec32_t) {} + src[0];
+#else
+	return (vec32_t) { src[0], src[0], src[0], src[0], src[1], src[1], src[1], src[1] };
+#endif
+}
+
+/* Blit from a 1, 2, 4 or 8 bpp source to 32 bpp through a lookup table that
+ * the source pixels index directly. For 1, 2 and 4 bpp, a table giving the
+ * expansion of each nibble (1 bpp) or byte (2 and 4 bpp) of source is built
+ * first, if the blit is big enough to repay it. 8 bpp sources are looked up
+ * a word at a time, or a vector at a time using AVX2 gathers. If values is
+ * non-NULL, the lookup table maps index 0 to values[0] and every other index
+ * to values[1], so 8 bpp sources select between them instead. */
+static ALWAYS_INLINE void blitExpandTo32(operation_t *op, uint32_t depth, const uint32_t *values, scalar_merge_t scalar, vector_merge_t vector)
+{
+	uint32_t pixMask = (1u << depth) - 1;
+	const uint32_t *lookup = *op->cmLookupTable;
+	uint32_t cmMask = op->cmMask;
+	size_t width = op->width;
+	size_t height = op->height;
+	size_t destPitch = op->dest.pitch / 4;
+	size_t srcPitch = op->src.pitch / 4;
+
+	uint32_t groupBits = depth == 1 ? 4 : depth == 8 ? 32 : 8;
+	uint32_t groupPixels = groupBits / depth;
+	uint32_t expansion[256 * 4] __attribute__((aligned(VECTOR_BYTES)));
+	bool grouped = depth == 8 || width * height >= (1u << groupBits) * groupPixels;
+	if (grouped && depth != 8)
+		for (uint32_t g = 0; g < 1u << groupBits; g++)
+			for (uint32_t j = 0; j < groupPixels; j++)
+				expansion[g * groupPixels + j] = lookup[(g >> (groupBits - depth * (j + 1))) & pixMask & cmMask];
+
+	for (size_t row = 0; row < height; row++) {
+		uint32_t *dest = (uint32_t *) op->dest.bits + (op->dest.y + row) * destPitch + op->dest.x;
+		const uint32_t *src = (const uint32_t *) op->src.bits + (op->src.y + row) * srcPitch;
+		size_t sx = op->src.x;
+		size_t x = 0;
+		uint32_t ht = halftoneWord(op, op->dest.y + row);
+		vec32_t htVector = (vec32_t) {} + ht;
+
+#define LOOKUP_PIXEL(sx) (lookup[(src[((sx) * depth) >> 5] >> (32 - depth - (((sx) * depth) & 31))) & pixMask & cmMask] & ht)
+
+		if (grouped) {
+			for (; x < width && (sx + x) % groupPixels != 0; x++)
+				dest[x] = scalar(LOOKUP_PIXEL(sx + x), dest[x]);
+			if (depth == 8 && values != NULL) {
+				vec32_t zeroValue = ((vec32_t) {} + values[0]) & htVector;
+				vec32_t difference = zeroValue ^ (values[1] & htVector);
+				vec32_t laneMask = ((vec32_t) {} + cmMask) << PIXEL8_SHIFTS;
+				for (; x + VECTOR_WORDS <= width; x += VECTOR_WORDS) {
+					vec32_t isZero = (vec32_t) ((loadPixels8(src + (sx + x) / 4) & laneMask) == 0);
+					storeVector(dest + x, vector(zeroValue ^ (difference & ~isZero), loadVector(dest + x)));
+				}
+			}
+#if VECTOR_BYTES == 32
+			if (depth == 8 && values == NULL) {
+				for (; x + VECTOR_WORDS <= width; x += VECTOR_WORDS) {
+					vec32_t index = (loadPixels8(src + (sx + x) / 4) >> PIXEL8_SHIFTS) & 0xFF & cmMask;
+					storeVector(dest + x, vector(gatherVector(lookup, index) & htVector, loadVector(dest + x)));
+				}
+			}
+#endif
+			for (; x + groupPixels <= width; x += groupPixels) {
+				size_t bit = (sx + x) * depth;
+				uint32_t group = src[bit >> 5];
+				if (groupBits < 32)
+					group = (group >> (32 - groupBits - (bit & 31))) & ((1u << groupBits) - 1);
+				for (uint32_t j = 0; j < groupPixels; j++) {
+					uint32_t pv = depth == 8 ? lookup[(group >> (24 - 8 * j)) & 0xFF & cmMask] : expansion[group * groupPixels + j];
+					dest[x + j] = scalar(pv & ht, dest[x + j]);
+				}
+			}
+		}
+		for (; x < width; x++)
+			dest[x] = scalar(LOOKUP_PIXEL(sx + x), dest[x]);
+
+#undef LOOKUP_PIXEL
+	}
+}
+
+/* Blit a solid colour, for colour maps that send every source pixel to the
+ * same value */
+static ALWAYS_INLINE void fillBlit(operation_t *op, uint32_t value, scalar_merge_t scalar, vector_merge_t vector)
+{
+	uint32_t depth = op->dest.depth;
+	size_t height = op->height;
+	size_t destPitch = op->dest.pitch / 4;
+	uint32_t pixMask = depth == 32 ? 0xFFFFFFFFu : (1u << depth) - 1;
+	uint32_t pattern = (value & pixMask) * (0xFFFFFFFFu / pixMask);
+	vec32_t patternVector = (vec32_t) {} + pattern;
+
+	size_t destBitStart = op->dest.x * depth;
+	size_t destBitEnd = destBitStart + op->width * depth;
+	intptr_t firstWord = destBitStart >> 5;
+	intptr_t lastWord = (destBitEnd - 1) >> 5;
+	uint32_t firstMask = 0xFFFFFFFFu >> (destBitStart & 31);
+	uint32_t lastMask = 0xFFFFFFFFu << (31 - ((destBitEnd - 1) & 31));
+	if (firstWord == lastWord)
+		firstMask = lastMask = firstMask & lastMask;
+	intptr_t fullFirst = firstWord + (firstMask != 0xFFFFFFFFu);
+	intptr_t fullLast = lastWord - (lastMask != 0xFFFFFFFFu);
+
+	for (size_t row = 0; row < height; row++) {
+		uint32_t *dest = (uint32_t *) op->dest.bits + (op->dest.y + row) * destPitch;
+		uint32_t ht = halftoneWord(op, op->dest.y + row);
+		vec32_t htVector = (vec32_t) {} + ht;
+		if (fullFirst != firstWord)
+			mergeEdge(dest, firstWord, pattern & ht, firstMask, scalar);
+		intptr_t w = fullFirst;
+		for (; w + VECTOR_WORDS - 1 <= fullLast; w += VECTOR_WORDS)
+			storeVector(dest + w, vector(patternVector & htVector, loadVector(dest + w)));
+		for (; w <= fullLast; w++)
+			dest[w] = scalar(pattern & ht, dest[w]);
+		if (fullLast != lastWord && lastWord != firstWord)
+			mergeEdge(dest, lastWord, pattern & ht, lastMask, scalar);
+	}
+}
+
+/* Colour-mapped fast paths pick the kernel for the colour map at run time */
+#define CONVERT_CASE(plan, map, indexed, merge)                               \
+	case plan: convertBlit(op, map##_map, indexed, merge##_scalar); return;
+
+#define DEFINE_COLOR_MAP_FAST_PATHS(name, merge)                              \
+static void x64_##name##_direct(operation_t *op, uint32_t flags)              \
+{                                                                             \
+	switch (x64ColorMapPlan(op)) {                                            \
+	case X64_CM_16_TO_32:                                                     \
+		if (op->src.depth == 16 && op->dest.depth == 32)                      \
+			blitMap16to32(op, merge##_scalar, merge##_vector);                \
+		else                                                                  \
+			convertBlit(op, map16to32_map, false, merge##_scalar);            \
+		return;                                                               \
+	case X64_CM_32_TO_15:                                                     \
+		if (op->src.depth == 32 && op->dest.depth == 16)                      \
+			blitMap32to16(op, merge##_scalar, merge##_vector);                \
+		else                                                                  \
+			convertBlit(op, map32to15_map, false, merge##_scalar);            \
+		return;                                                               \
+	default: copyBitsFallback(op, flags); return;                             \
+	}                                                                         \
+}                                                                             \
+static void x64_##name##_indexed(operation_t *op, uint32_t flags)             \
+{                                                                             \
+	uint32_t values[2];                                                       \
+	if (x64LookupShape(op, values) == X64_LOOKUP_CONSTANT) {                  \
+		fillBlit(op, values[0], merge##_scalar, merge##_vector);              \
+		return;                                                               \
+	}                                                                         \
+	switch (x64ColorMapPlan(op)) {                                            \
+	CONVERT_CASE(X64_CM_NO_FIXED_PART, noFixedPart, true,  merge)             \
+	CONVERT_CASE(X64_CM_16_TO_9,       map16to9,    true,  merge)             \
+	CONVERT_CASE(X64_CM_16_TO_12,      map16to12,   true,  merge)             \
+	CONVERT_CASE(X64_CM_16_TO_32,      map16to32,   true,  merge)             \
+	CONVERT_CASE(X64_CM_32_TO_9,       map32to9,    true,  merge)             \
+	CONVERT_CASE(X64_CM_32_TO_12,      map32to12,   true,  merge)             \
+	CONVERT_CASE(X64_CM_32_TO_15,      map32to15,   true,  merge)             \
+	default: copyBitsFallback(op, flags); return;                             \
+	}                                                                         \
+}                                                                             \
+static void x64_##name##_expand(operation_t *op, uint32_t flags)              \
+{                                                                             \
+	IGNORE(flags);                                                            \
+	uint32_t values[2];                                                       \
+	switch (x64LookupShape(op, values)) {                                     \
+	case X64_LOOKUP_CONSTANT:                                                 \
+		fillBlit(op, values[0], merge##_scalar, merge##_vector);              \
+		return;                                                               \
+	case X64_LOOKUP_TWO_VALUED:                                               \
+		if (op->src.depth == 8) {                                             \
+			blitExpandTo32(op, 8, values, merge##_scalar, merge##_vector);    \
+			return;                                                           \
+		}                                                                     \
+		break;                                                                \
+	default:                                                                  \
+		break;                                                                \
+	}                                                                         \
+	switch (op->src.depth) {                                                  \
+	case 1: blitExpandTo32(op, 1, NULL, merge##_scalar, merge##_vector); break; \
+	case 2: blitExpandTo32(op, 2, NULL, merge##_scalar, merge##_vector); break; \
+	case 4: blitExpandTo32(op, 4, NULL, merge##_scalar, merge##_vector); break; \
+	case 8: blitExpandTo32(op, 8, NULL, merge##_scalar, merge##_vector); break; \
+	}                                                                         \
+}
+
+DEFINE_COLOR_MAP_FAST_PATHS(sourceWord, sourceWord)
+DEFINE_COLOR_MAP_FAST_PATHS(alphaBlend, alphaBlend32)
+
+/******************************************************************************/
+
+#define DEFINE_FAST_PATH(name, merge)                                         \
+static void x64_##name(operation_t *op, uint32_t flags)                       \
+{                                                                             \
+	IGNORE(flags);                                                            \
+	if (op->noHalftone)                                                       \
+		blit(op, false, merge##_scalar, merge##_vector);                      \
+	else                                                                      \
+		blit(op, true, merge##_scalar, merge##_vector);                       \
+}
+
+DEFINE_FAST_PATH(clearWord,            clearWord)
+DEFINE_FAST_PATH(bitAnd,               bitAnd)
+DEFINE_FAST_PATH(bitAndInvert,         bitAndInvert)
+DEFINE_FAST_PATH(sourceWord,           sourceWord)
+DEFINE_FAST_PATH(bitInvertAnd,         bitInvertAnd)
+DEFINE_FAST_PATH(destinationWord,      destinationWord)
+DEFINE_FAST_PATH(bitXor,               bitXor)
+DEFINE_FAST_PATH(bitOr,                bitOr)
+DEFINE_FAST_PATH(bitInvertAndInvert,   bitInvertAndInvert)
+DEFINE_FAST_PATH(bitInvertXor,         bitInvertXor)
+DEFINE_FAST_PATH(bitInvertDestination, bitInvertDestination)
+DEFINE_FAST_PATH(bitOrInvert,          bitOrInvert)
+DEFINE_FAST_PATH(bitInvertSource,      bitInvertSource)
+DEFINE_FAST_PATH(bitInvertOr,          bitInvertOr)
+DEFINE_FAST_PATH(bitInvertOrInvert,    bitInvertOrInvert)
+DEFINE_FAST_PATH(alphaBlend_32_32,     alphaBlend32)
+DEFINE_FAST_PATH(pixPaint_8_8,         pixPaint8)
+DEFINE_FAST_PATH(pixPaint_16_16,       pixPaint16)
+DEFINE_FAST_PATH(pixPaint_32_32,       pixPaint32)
+
+#define FAST_PATH_ENTRY(name, rule, flags) { x64_##name, rule, flags },
+
+fast_path_t X64_FAST_PATH_TABLE[] = {
+	X64_FAST_PATHS(FAST_PATH_ENTRY)
+};
@@ -0,0 +1,207 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+/* Seeding of the fuzz testers' random number generators, and filling of
+ * buffers from them. See FuzzRand.h. */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "FuzzRand.h"
+
+void fuzzRandSeed(fuzz_rand_t *r, fuzz_rand_kind_t kind, uint32_t seed)
+{
+	r->kind = kind;
+	if (kind == FUZZ_RAND_FAST) {
+		r->pcg = 0;
+		(void) fuzzRand(r);
+		r->pcg += seed;
+		(void) fuzzRand(r);
+		return;
+	}
+
+	/* As glibc's srandom_r(): fill the table with a Lehmer sequence, using
+	 * Schrage's method to avoid overflow, then discard the first 310
+	 * outputs. Note that the seed is treated as signed. */
+	if (seed == 0)
+		seed = 1;
+	int32_t word = (int32_t) seed;
+	r->table[0] = seed;
+	for (uint32_t i = 1; i < 31; i++) {
+		int32_t hi = word / 127773;
+		int32_t lo = word % 127773;
+		word = 16807 * lo - 2836 * hi;
+		if (word < 0)
+			word += 2147483647;
+		r->table[i] = word;
+	}
+	r->front = 3;
+	r->rear = 0;
+	for (uint32_t i = 0; i < 310; i++)
+		(void) fuzzRand(r);
+}
+
+#define MIN(a,b) ((a)<(b)?(a):(b))
+
+typedef enum {
+	FILL_ZEROS,
+	FILL_RAND,
+	FILL_ONES
+} fill_t;
+
+static void fillLegacy(fuzz_rand_t *r, fuzz_runs_t runs, uint32_t *buf, size_t nWords)
+{
+	size_t totalRemain = nWords * 32;
+	uint32_t word = 0;
+	size_t wordRemain = 32;
+	do {
+		fill_t blockType = fuzzRand(r) % 3;
+		size_t blockRemain;
+		if (runs == FUZZ_RUNS_SHORT) {
+			blockRemain = fuzzRand(r) % 64 + 1;
+		} else {
+			uint8_t msbBlockRemain = fuzzRand(r) % 10;
+			blockRemain = 1u << msbBlockRemain;
+			blockRemain |= fuzzRand(r) & (blockRemain - 1);
+		}
+		blockRemain = MIN(blockRemain, totalRemain);
+		do {
+			if (wordRemain == 32 && blockRemain >= 32 && blockType != FILL_RAND) {
+				/* Whole words of a constant need no random numbers */
+				uint32_t fill = blockType == FILL_ONES ? 0xFFFFFFFF : 0;
+				size_t words = blockRemain / 32;
+				for (size_t i = 0; i < words; i++)
+					*buf++ = fill;
+				word = fill;
+				totalRemain -= words * 32;
+				blockRemain -= words * 32;
+				continue;
+			}
+			size_t bitsThisTime = MIN(blockRemain, wordRemain);
+			if (blockType == FILL_RAND && bitsThisTime > 16)
+				bitsThisTime = 16;
+			word = bitsThisTime == 32 ? 0 : word << bitsThisTime;
+			if (blockType == FILL_ONES) {
+				word |= (1ul << bitsThisTime) - 1;
+			} else if (blockType == FILL_RAND) {
+				word |= fuzzRand(r) & ((1ul << bitsThisTime) - 1);
+			}
+			totalRemain -= bitsThisTime;
+			blockRemain -= bitsThisTime;
+			wordRemain -= bitsThisTime;
+			if (wordRemain == 0) {
+				*buf++ = word;
+				wordRemain = 32;
+			}
+		} while (blockRemain > 0);
+	} while (totalRemain > 0);
+}
+
+/* The fast fill is written to avoid unpredictable branches, which would
+ * otherwise cost more than generating the bits. State between runs is the
+ * bits not yet stored, oldest highest, fewer than 32 of them. */
+typedef struct {
+	uint64_t  bits;
+	unsigned  count;
+	uint32_t *buf;
+} pending_t;
+
+/* Append up to 32 bits of a run, storing a word if one is complete. The
+ * store always happens, but the pointer only advances past a whole word. */
+static inline void append(pending_t *p, uint32_t bits, unsigned n)
+{
+	p->bits = p->bits << n | (bits & (((uint64_t) 1 << n) - 1));
+	p->count += n;
+	unsigned full = p->count >> 5;
+	*p->buf = p->bits >> (p->count & 31);
+	p->buf += full;
+	p->count -= full << 5;
+}
+
+static inline uint32_t runBits(fuzz_rand_t *r, fill_t blockType)
+{
+	uint32_t random = fuzzRandPcg32(r);
+	uint32_t useRandom = -(uint32_t) (blockType == FILL_RAND);
+	uint32_t ones = -(uint32_t) (blockType == FILL_ONES);
+	return (random & useRandom) | ones;
+}
+
+static void fillFast(fuzz_rand_t *r, fuzz_runs_t runs, uint32_t *buf, size_t nWords)
+{
+	uint32_t *end = buf + nWords;
+	pending_t p = { 0, 0, buf };
+	if (runs == FUZZ_RUNS_SHORT) {
+		/* Each run's kind and length take 16 bits of a draw, and a run of
+		 * up to 64 bits is always appended as two parts */
+		while (p.buf < end) {
+			uint32_t draw = fuzzRandPcg32(r);
+			for (int half = 0; half < 2 && p.buf < end; half++, draw >>= 16) {
+				fill_t blockType = (draw >> 6 & 0x3FF) * 3 >> 10;
+				unsigned blockRemain = (draw & 63) + 1;
+				unsigned first = blockRemain < 32 ? blockRemain : 32;
+				append(&p, runBits(r, blockType), first);
+				if (p.buf < end)
+					append(&p, runBits(r, blockType), blockRemain - first);
+			}
+		}
+		return;
+	}
+	/* Long runs average several words, so branching per run costs little,
+	 * and runs of a constant are stored a whole word at a time */
+	while (p.buf < end) {
+		uint32_t draw = fuzzRandPcg32(r);
+		/* The run's kind and the most significant bit of its length are
+		 * drawn together from the top 23 bits, by multiply and shift, which
+		 * is unbiased to within a few parts per million */
+		uint32_t pick = (uint64_t) (draw >> 9) * 30 >> 23;
+		fill_t blockType = pick / 10;
+		uint32_t msbBlockRemain = pick % 10;
+		size_t blockRemain = 1u << msbBlockRemain;
+		blockRemain |= draw & (blockRemain - 1);
+		if (blockType != FILL_RAND) {
+			uint32_t fill = blockType == FILL_ONES ? 0xFFFFFFFF : 0;
+			unsigned first = MIN(blockRemain, 32 - p.count);
+			append(&p, fill, first);
+			blockRemain -= first;
+			for (; blockRemain >= 32 && p.buf < end; blockRemain -= 32)
+				*p.buf++ = fill;
+			if (p.buf < end)
+				append(&p, fill, blockRemain);
+			continue;
+		}
+		while (blockRemain > 0 && p.buf < end) {
+			unsigned bitsThisTime = blockRemain < 32 ? blockRemain : 32;
+			append(&p, fuzzRandPcg32(r), bitsThisTime);
+			blockRemain -= bitsThisTime;
+		}
+	}
+}
+
+void fuzzRandFill(fuzz_rand_t *r, fuzz_runs_t runs, uint32_t *buf, size_t nWords)
+{
+	if (r->kind == FUZZ_RAND_FAST)
+		fillFast(r, runs, buf, nWords);
+	else
+		fillLegacy(r, runs, buf, nWords);
+}
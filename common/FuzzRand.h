@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#ifndef FUZZRAND_H_
+#define FUZZRAND_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Reentrant pseudo-random number generators for the fuzz testers. Every
+ * generator has its own state, so tests can be generated on several threads
+ * at once, and each returns values in the range 0 to FUZZ_RAND_MAX, like
+ * rand() does.
+ *
+ * The legacy generator reproduces glibc's rand() and srand() exactly (the
+ * TYPE_3 additive feedback generator), which the reference CRC tables were
+ * made with. The fast generator is PCG32; it is cheaper to seed, which
+ * matters because the testers reseed for every iteration. */
+
+#define FUZZ_RAND_MAX (0x7FFFFFFF)
+
+typedef enum {
+	FUZZ_RAND_LEGACY,
+	FUZZ_RAND_FAST
+} fuzz_rand_kind_t;
+
+typedef struct {
+	fuzz_rand_kind_t kind;
+	/* Legacy generator */
+	uint32_t         front;
+	uint32_t         rear;
+	uint32_t         table[31];
+	/* Fast generator */
+	uint64_t         pcg;
+} fuzz_rand_t;
+
+/* How long the runs of zeros, ones and random bits that fuzzRandFill()
+ * makes are: 1 to 64 bits evenly, or 1 to 1023 bits with each power of two
+ * equally likely */
+typedef enum {
+	FUZZ_RUNS_SHORT,
+	FUZZ_RUNS_LONG
+} fuzz_runs_t;
+
+void fuzzRandSeed(fuzz_rand_t *r, fuzz_rand_kind_t kind, uint32_t seed);
+
+/* Fill a buffer with random data, but favouring runs of all 0 or all 1.
+ * With the legacy generator, this produces exactly what the testers always
+ * have, bit by bit, so the reference CRCs stay valid. The fast generator
+ * makes runs with the same mix of kinds and lengths a word at a time, using
+ * one draw per run and 32 random bits per draw. */
+void fuzzRandFill(fuzz_rand_t *r, fuzz_runs_t runs, uint32_t *buf, size_t nWords);
+
+/* A full 32-bit output of the fast generator */
+static inline uint32_t fuzzRandPcg32(fuzz_rand_t *r)
+{
+	uint64_t old = r->pcg;
+	r->pcg = old * 6364136223846793005ull + 1442695040888963407ull;
+	uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+	uint32_t rot = old >> 59;
+	return (xorshifted >> rot) | (xorshifted << (-rot & 31));
+}
+
+static inline uint32_t fuzzRand(fuzz_rand_t *r)
+{
+	if (r->kind == FUZZ_RAND_FAST)
+		return fuzzRandPcg32(r) >> 1;
+	uint32_t front = r->front, rear = r->rear;
+	uint32_t val = r->table[front] += r->table[rear];
+	r->front = front == 30 ? 0 : front + 1;
+	r->rear = rear == 30 ? 0 : rear + 1;
+	return val >> 1;
+}
+
+#endif /* FUZZRAND_H_ */
@@ -0,0 +1,177 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <getopt.h>
+
+/* Compare two CSV reports produced with the --csv option of the benchmark
+ * harnesses, and flag any test whose median throughput has dropped by more
+ * than the threshold. Records are matched on every field before the median;
+ * where a report contains repeated records for the same test (from -i), their
+ * medians are averaged. */
+
+#define KEYFIELDS (7)
+#define MAXLINE (1024)
+#define DEFAULT_THRESHOLD (5.0)
+
+typedef struct {
+	char *key;
+	double total;
+	unsigned count;
+	bool matched;
+} entry_t;
+
+typedef struct {
+	entry_t *entry;
+	size_t count;
+	size_t capacity;
+} report_t;
+
+static void *allocate(size_t size)
+{
+	void *p = malloc(size);
+	if (p == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+static entry_t *find(report_t *report, const char *key)
+{
+	for (size_t i = 0; i < report->count; i++)
+		if (strcmp(report->entry[i].key, key) == 0)
+			return &report->entry[i];
+	return NULL;
+}
+
+static void load(report_t *report, const char *filename)
+{
+	FILE *f = fopen(filename, "r");
+	if (f == NULL) {
+		perror(filename);
+		exit(EXIT_FAILURE);
+	}
+	char line[MAXLINE];
+	unsigned lineNumber = 0;
+	while (fgets(line, sizeof line, f) != NULL) {
+		lineNumber++;
+		line[strcspn(line, "\r\n")] = '\0';
+		if (lineNumber == 1 && strncmp(line, "harness,", 8) == 0)
+			continue;
+		if (line[0] == '\0')
+			continue;
+		/* The key is everything up to the KEYFIELDS'th comma */
+		char *p = line;
+		int fields;
+		for (fields = 0; fields < KEYFIELDS && (p = strchr(p, ',')) != NULL; fields++)
+			p++;
+		char *end;
+		double median = p == NULL ? 0 : strtod(p, &end);
+		if (p == NULL || end == p || (*end != ',' && *end != '\0')) {
+			fprintf(stderr, "%s:%u: not a benchmark record\n", filename, lineNumber);
+			exit(EXIT_FAILURE);
+		}
+		p[-1] = '\0';
+		entry_t *e = find(report, line);
+		if (e == NULL) {
+			if (report->count == report->capacity) {
+				report->capacity = report->capacity ? report->capacity * 2 : 64;
+				report->entry = realloc(report->entry, report->capacity * sizeof *report->entry);
+				if (report->entry == NULL) {
+					fprintf(stderr, "Out of memory\n");
+					exit(EXIT_FAILURE);
+				}
+			}
+			e = &report->entry[report->count++];
+			e->key = strcpy(allocate(strlen(line) + 1), line);
+			e->total = 0;
+			e->count = 0;
+			e->matched = false;
+		}
+		e->total += median;
+		e->count++;
+	}
+	fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+	double threshold = DEFAULT_THRESHOLD;
+	bool verbose = false;
+
+	bool help = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "ht:v")) != -1) {
+		switch (opt) {
+		case 'h': help = true; break;
+		case 't': threshold = atof(optarg); break;
+		case 'v': verbose = true; break;
+		default: help = true; break;
+		}
+	}
+	if (help || optind != argc - 2) {
+		fprintf(stderr, "Syntax: %s [-h] [-t threshold percent] [-v] baseline.csv candidate.csv\n", argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	report_t baseline = { NULL, 0, 0 }, candidate = { NULL, 0, 0 };
+	load(&baseline, argv[optind]);
+	load(&candidate, argv[optind + 1]);
+
+	unsigned regressions = 0, improvements = 0, compared = 0;
+	for (size_t i = 0; i < baseline.count; i++) {
+		entry_t *b = &baseline.entry[i];
+		entry_t *c = find(&candidate, b->key);
+		if (c == NULL) {
+			printf("%-60s missing from candidate\n", b->key);
+			continue;
+		}
+		c->matched = true;
+		compared++;
+		double before = b->total / b->count;
+		double after = c->total / c->count;
+		double change = before > 0 ? 100.0 * (after - before) / before : 0;
+		const char *verdict = "";
+		if (change < -threshold) {
+			verdict = "  REGRESSION";
+			regressions++;
+		} else if (change > threshold) {
+			verdict = "  improvement";
+			improvements++;
+		}
+		if (verbose || *verdict != '\0')
+			printf("%-60s %10.2f -> %10.2f MB/s %+7.2f%%%s\n", b->key, before, after, change, verdict);
+	}
+	for (size_t i = 0; i < candidate.count; i++)
+		if (!candidate.entry[i].matched)
+			printf("%-60s missing from baseline\n", candidate.entry[i].key);
+
+	printf("%u tests compared: %u regressions, %u improvements beyond %.1f%%\n", compared, regressions, improvements, threshold);
+	exit(regressions > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
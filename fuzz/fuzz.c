@@ -23,6 +23,8 @@
  *
  */
 
+#define _GNU_SOURCE
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -30,8 +32,18 @@
 #include <stdbool.h>
 
 #include <getopt.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "BitBltDispatch.h"
+#include "BitBltBatch.h"
+#include "BenchCrc.h"
+#include "BenchSurface.h"
+#include "FuzzRand.h"
+#ifdef __x86_64__
+#include "BitBltX64.h"
+#endif
 
 #define MIN(a,b) ((a)<(b)?(a):(b))
 #define MAX(a,b) ((a)>(b)?(a):(b))
@@ -135,6 +147,19 @@ struct {
 		{ CR_rgbComponentAlpha,    true,  LOG2_1,  LOG2_32, true,  true,  true  },
 };
 
+/* alphaBlend onto 32 bpp from shallower sources, through a colour map. These
+ * are kept out of tests[] so that the reference CRCs still apply. -a adds
+ * them, and dispatches every test through copyBitsDispatchBatch(), so the
+ * batched entry point's choice of kernel is covered too. */
+static const uint32_t alphaBlendMappedDepths[] = { LOG2_1, LOG2_2, LOG2_4, LOG2_8, LOG2_16 };
+static bool alphaBlendMapped;
+
+/* With -o, half of the tests that have a source take it from the destination
+ * form instead, from a rectangle within a few pixels and rows of the one they
+ * write, to exercise the ordering of overlapping blits. These have no
+ * reference CRCs either. */
+static bool overlapTests;
+
 static unsigned int  maskTable53[4] = { 0x7000, 0x0380, 0x001C, 0x0000 };
 static          int shiftTable53[4] = {     -6,     -4,     -2,      0 };
 static unsigned int  maskTable54[4] = { 0x7800, 0x03C0, 0x001E, 0x0000 };
@@ -219,114 +244,98 @@ const char *combinationRuleName[] = {
 		"rgbComponentAlpha",
 };
 
+static fuzz_rand_kind_t randKind = FUZZ_RAND_LEGACY;
+
+/* Default surface size limits, and how far -W and -H can raise them */
 #define MAXWIDTH (3840)
 #define MAXHEIGHT (16)
-
-/* Public domain CRC function */
-static uint32_t compute_crc32 (uint32_t in_crc32, const void *buf, size_t buf_len)
+#define LIMITWIDTH (8192)
+#define LIMITHEIGHT (4096)
+
+static size_t maxWidth = MAXWIDTH;
+static size_t maxHeight = MAXHEIGHT;
+
+/* Each surface has room for maxWidth x maxHeight pixels at 32 bpp. The
+ * destination is restored from its pristine copy between tests. */
+static size_t surfaceWords;
+static bench_surface_t srcSurface;
+static bench_surface_t destSurface;
+static uint32_t *src;
+static uint32_t *dest;
+
+/* For differential testing: the generic code's result, and the lookup table
+ * as the dispatched operation left it, since some rules update the table */
+static bool differential;
+static bench_surface_t refSurface;
+static uint32_t *dest_ref;
+static uint32_t lookupTableFast[32768];
+
+/* How each test's CRC is found: over the whole of the destination rows it
+ * used, from only the rectangle it could have changed, or both, stopping if
+ * they disagree */
+typedef enum {
+	CRC_FULL,
+	CRC_RECT,
+	CRC_CROSSCHECK
+} crc_mode_t;
+
+static crc_mode_t crcMode = CRC_FULL;
+
+/* CRCs of the first multiples of PREFIXBYTES of the pristine destination,
+ * and room for one row of differences */
+#define PREFIXBYTES (64)
+static uint32_t *pristinePrefix;
+static uint32_t rowDiff[LIMITWIDTH];
+
+static void buildPristinePrefix(void)
 {
-    static const uint32_t crc_table[256] = {
-	0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F,
-	0xE963A535, 0x9E6495A3, 0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
-	0x09B64C2B, 0x7EB17CBD,	0xE7B82D07, 0x90BF1D91, 0x1DB71064, 0x6AB020F2,
-	0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
-	0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC,	0x14015C4F, 0x63066CD9,
-	0xFA0F3D63, 0x8D080DF5, 0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
-	0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C,
-	0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
-	0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423,
-	0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
-	0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D, 0x76DC4190, 0x01DB7106,
-	0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-	0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D,
-	0x91646C97, 0xE6635C01, 0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
-	0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950,
-	0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
-	0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7,
-	0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
-	0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9, 0x5005713C, 0x270241AA,
-	0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
-	0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81,
-	0xB7BD5C3B, 0xC0BA6CAD, 0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
-	0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683, 0xE3630B12, 0x94643B84,
-	0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-	0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB,
-	0x196C3671, 0x6E6B06E7, 0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
-	0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5, 0xD6D6A3E8, 0xA1D1937E,
-	0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
-	0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55,
-	0x316E8EEF, 0x4669BE79, 0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
-	0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28,
-	0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
-	0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F,
-	0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
-	0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21, 0x86D3D2D4, 0xF1D4E242,
-	0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-	0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69,
-	0x616BFFD3, 0x166CCF45, 0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
-	0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC,
-	0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
-	0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693,
-	0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
-	0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
-    };
-
-    uint32_t              crc32;
-    unsigned char *       byte_buf;
-    size_t                i;
-
-    /* accumulate crc32 for buffer */
-    crc32 = in_crc32 ^ 0xFFFFFFFF;
-    byte_buf = (unsigned char*) buf;
-
-    for (i = 0; i < buf_len; i++)
-	crc32 = (crc32 >> 8) ^ crc_table[(crc32 ^ byte_buf[i]) & 0xFF];
-
-    return (crc32 ^ 0xFFFFFFFF);
+	const uint8_t *pristine = destSurface.pristine;
+	size_t blocks = surfaceWords * 4 / PREFIXBYTES;
+	pristinePrefix = malloc((blocks + 1) * sizeof *pristinePrefix);
+	if (pristinePrefix == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	pristinePrefix[0] = 0;
+	for (size_t i = 0; i < blocks; i++)
+		pristinePrefix[i + 1] = benchCrc32(pristinePrefix[i], pristine + i * PREFIXBYTES, PREFIXBYTES);
 }
 
-static uint32_t randLog2Depth(void)
+/* The CRC of the first rows of the destination, looking only at the part of
+ * them inside a rectangle. CRCs are linear, so the CRC of the destination is
+ * that of the pristine copy, XORed with the CRC register (uninverted) after
+ * feeding it the difference between the two. The difference is zero outside
+ * the rectangle, and runs of zeros are skipped by multiplying the register
+ * by a power of x. */
+static uint32_t rectCrc(const bench_rect_t *r, size_t rows)
 {
-	/* Emphasise 32, 16, 8 bpp over < 8bpp */
-	const uint8_t options[] = { 0, 1, 2, 3, 3, 4, 4, 5, 5, 5 };
-	return options[rand() % sizeof options];
+	const uint8_t *pristine = destSurface.pristine;
+	size_t len = rows * r->pitch;
+	size_t block = len / PREFIXBYTES;
+	uint32_t crc = benchCrc32(pristinePrefix[block], pristine + block * PREFIXBYTES, len % PREFIXBYTES);
+
+	size_t bottom = MIN(r->bottom, rows);
+	if (r->top >= bottom || r->left == r->right)
+		return crc;
+	size_t width = r->right - r->left;
+	uint32_t gap = benchCrc32Zeros(r->pitch - width);
+	uint32_t diff = 0;
+	for (size_t y = r->top; y < bottom; y++) {
+		const uint32_t *now = (const uint32_t *) ((const uint8_t *) dest + y * r->pitch + r->left);
+		const uint32_t *was = (const uint32_t *) (pristine + y * r->pitch + r->left);
+		for (size_t i = 0; i < width / 4; i++)
+			rowDiff[i] = now[i] ^ was[i];
+		diff = benchCrc32Update(benchCrc32Multiply(diff, gap), rowDiff, width);
+	}
+	size_t end = (bottom - 1) * r->pitch + r->right;
+	return crc ^ benchCrc32Multiply(diff, benchCrc32Zeros(len - end));
 }
 
-static void fillWithRand(uint32_t *buf, size_t nWords)
+static uint32_t randLog2Depth(fuzz_rand_t *rng)
 {
-	/* Fill a block with random data, but prefer runs of all 1 or 0 */
-	size_t totalRemain = nWords * 32;
-	uint32_t word = 0;
-	size_t wordRemain = 32;
-	do {
-		enum {
-			FILL_ZEROS,
-			FILL_RAND,
-			FILL_ONES
-		} blockType = rand() % 3;
-		uint8_t msbBlockRemain = rand() % 10;
-		size_t blockRemain = 1u << msbBlockRemain;
-		blockRemain |= rand() & (blockRemain - 1);
-		blockRemain = MIN(blockRemain, totalRemain);
-		do {
-			size_t bitsThisTime = MIN(blockRemain, wordRemain);
-			if (blockType == FILL_RAND && bitsThisTime > 16)
-				bitsThisTime = 16;
-			word = bitsThisTime == 32 ? 0 : word << bitsThisTime;
-			if (blockType == FILL_ONES) {
-				word |= (1ul << bitsThisTime) - 1;
-			} else if (blockType == FILL_RAND) {
-				word |= rand() & ((1ul << bitsThisTime) - 1);
-			}
-			totalRemain -= bitsThisTime;
-			blockRemain -= bitsThisTime;
-			wordRemain -= bitsThisTime;
-			if (wordRemain == 0) {
-				*buf++ = word;
-				wordRemain = 32;
-			}
-		} while (blockRemain > 0);
-	} while (totalRemain > 0);
+	/* Emphasise 32, 16, 8 bpp over < 8bpp */
+	const uint8_t options[] = { 0, 1, 2, 3, 3, 4, 4, 5, 5, 5 };
+	return options[fuzzRand(rng) % sizeof options];
 }
 
 static void dumpBuffer(uint32_t *buf, size_t wordsPerRow, size_t rows, uint32_t log2bpp, bool bigEndian)
@@ -354,23 +363,456 @@ static void dumpBuffer(uint32_t *buf, size_t wordsPerRow, size_t rows, uint32_t
 	}
 }
 
-void warning(const char *message)
+/* Run an operation again through the generic code, and stop at the first
+ * difference from what the dispatcher produced within the guarded rectangle
+ * of the destination. This runs on a copy of the operation made before it
+ * was dispatched. */
+static void checkAgainstReference(size_t iter, operation_t *op, const bench_rect_t *guard)
 {
-    (void) message;
-//    fprintf(stderr, "warning: %s\n", message);
+	if (op->cmLookupTable) {
+		memcpy(lookupTableFast, op->cmLookupTable, sizeof lookupTableFast);
+		memcpy(op->cmLookupTable, lookupTableBackup, sizeof lookupTableBackup);
+	}
+	benchSurfaceRestore(&refSurface);
+	benchSurfaceDirty(&refSurface, guard);
+	if (op->src.bits == op->dest.bits)
+		op->src.bits = dest_ref;
+	op->dest.bits = dest_ref;
+	copyBitsFallback(op, 0);
+
+	char what[80];
+	if (op->noSource)
+		snprintf(what, sizeof what, "%s at %"PRIuSQINT" bpp",
+				combinationRuleName[op->combinationRule], op->dest.depth);
+	else
+		snprintf(what, sizeof what, "%s from %"PRIuSQINT" to %"PRIuSQINT" bpp",
+				combinationRuleName[op->combinationRule], op->src.depth, op->dest.depth);
+
+	size_t wordsPerRow = op->dest.pitch / 4;
+	for (size_t y = guard->top; y < guard->bottom; y++) {
+		for (size_t word = guard->left / 4; word < guard->right / 4; word++) {
+			size_t i = y * wordsPerRow + word;
+			if (i >= surfaceWords)
+				break;
+			uint32_t diff = dest[i] ^ dest_ref[i];
+			if (diff == 0)
+				continue;
+			uint32_t bpp = op->dest.depth;
+			uint32_t mask = bpp == 32 ? 0xFFFFFFFF : (1u << bpp) - 1;
+			uint32_t pixel, shift;
+			if (op->dest.msb) {
+				pixel = __builtin_clz(diff) / bpp;
+				shift = 32 - bpp * (pixel + 1);
+			} else {
+				pixel = __builtin_ctz(diff) / bpp;
+				shift = bpp * pixel;
+			}
+			size_t x = word * (32 / bpp) + pixel;
+			bool outside = x < (size_t) op->dest.x || x >= (size_t) (op->dest.x + op->width) ||
+			               y < (size_t) op->dest.y || y >= (size_t) (op->dest.y + op->height);
+			fprintf(stderr, "Iteration %zu, %s: pixel %zu,%zu%s is 0x%X but should be 0x%X\n",
+					iter, what, x, y, outside ? " (outside the destination rectangle)" : "",
+					(dest[i] >> shift) & mask, (dest_ref[i] >> shift) & mask);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (op->cmLookupTable) {
+		for (size_t i = 0; i < sizeof lookupTableFast / sizeof *lookupTableFast; i++) {
+			if (lookupTableFast[i] != (*op->cmLookupTable)[i]) {
+				fprintf(stderr, "Iteration %zu, %s: lookup table entry %zu is 0x%X but should be 0x%X\n",
+						iter, what, i, lookupTableFast[i], (*op->cmLookupTable)[i]);
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
 }
 
-int main(int argc, char *argv[])
+/* Only each test's guarded rectangle is restored before the next test, so a
+ * write anywhere else in the destination would survive, and show up as a CRC
+ * mismatch in some later test. With -x or -d, the rows of each test's
+ * destination are checked for such writes after it runs, so the test that
+ * made one is caught. Otherwise, to keep the cost of a test in proportion to
+ * its blit, all of the destination is checked every OUTSIDE_CHECK_INTERVAL
+ * tests instead, which narrows it down to that many. */
+#define OUTSIDE_CHECK_INTERVAL (256)
+
+static size_t uncheckedTests;
+
+/* Stop at the first byte of [low, high) of the destination that differs from
+ * the pristine copy */
+static void checkUntouched(size_t iter, size_t pitch, size_t low, size_t high)
 {
-	size_t min_iter = 0;
-	size_t max_iter = 1048576;
-	bool help = false;
-	uint32_t verbose = 0;
+	const uint8_t *now = (const uint8_t *) dest;
+	const uint8_t *was = destSurface.pristine;
+	if (low >= high || memcmp(now + low, was + low, high - low) == 0)
+		return;
+	while (now[low] == was[low])
+		low++;
+	if (uncheckedTests <= 1)
+		fprintf(stderr, "Iteration %zu: byte %zu of destination row %zu was written, outside the guarded rectangle\n",
+				iter, low % pitch, low / pitch);
+	else
+		fprintf(stderr, "Iteration %zu: byte %zu of destination row %zu was written, outside the guarded rectangle "
+				"of this test or one of the %zu before it; rerun with -x to find which\n",
+				iter, low % pitch, low / pitch, uncheckedTests - 1);
+	exit(EXIT_FAILURE);
+}
 
-	bool check = true;
-	uint32_t cumulative_crc = 0;
-	size_t check_index = 0;
-	uint32_t check_table[] = {
+static void checkOutsideGuard(size_t iter, const bench_rect_t *guard, size_t rows)
+{
+	size_t pitch = guard->pitch;
+	size_t end = MIN(rows * pitch, surfaceWords * 4);
+	if (guard->top == guard->bottom || guard->left == guard->right) {
+		checkUntouched(iter, pitch, 0, end);
+		return;
+	}
+	checkUntouched(iter, pitch, 0, MIN(guard->top * pitch + guard->left, end));
+	for (size_t y = guard->top; y + 1 < guard->bottom; y++)
+		checkUntouched(iter, pitch, y * pitch + guard->right, MIN((y + 1) * pitch + guard->left, end));
+	checkUntouched(iter, pitch, (guard->bottom - 1) * pitch + guard->right, end);
+}
+
+/* Run one test, returning the CRC of the destination afterwards */
+static uint32_t runTest(size_t iter, uint32_t verbose)
+{
+	fuzz_rand_t rng;
+	fuzzRandSeed(&rng, randKind, iter ^ (iter << 16));
+
+	size_t src_w = fuzzRand(&rng) % maxWidth + 1;
+	size_t src_h = fuzzRand(&rng) % maxHeight + 1;
+	size_t dest_w = fuzzRand(&rng) % maxWidth + 1;
+	size_t dest_h = fuzzRand(&rng) % maxHeight + 1;
+
+	size_t testCount = sizeof tests / sizeof *tests;
+	if (alphaBlendMapped)
+		testCount += sizeof alphaBlendMappedDepths / sizeof *alphaBlendMappedDepths;
+	size_t test = fuzzRand(&rng) % testCount;
+	bool mapped = test >= sizeof tests / sizeof *tests;
+	operation_t op;
+	op.combinationRule = mapped ? CR_alphaBlend : tests[test].cr;
+	op.noSource = mapped ? false : tests[test].noSource;
+	op.src.bits = src;
+	op.dest.bits = dest;
+
+	bool useLookupTable = fuzzRand(&rng) & 1;
+	uint32_t log2srcDepth, log2destDepth;
+	if (mapped) {
+		log2srcDepth = alphaBlendMappedDepths[test - sizeof tests / sizeof *tests];
+		log2destDepth = LOG2_32;
+		if (log2srcDepth < 4)
+			useLookupTable = true;
+	} else if (tests[test].log2minDepth == tests[test].log2maxDepth) {
+		/* Only one depth supported */
+		log2srcDepth = log2destDepth = tests[test].log2minDepth;
+	} else {
+		do {
+			log2srcDepth = randLog2Depth(&rng);
+		} while (log2srcDepth < tests[test].log2minDepth || log2srcDepth > tests[test].log2maxDepth);
+		if (fuzzRand(&rng) & 1) {
+			/* More likely to have matching depths */
+			log2destDepth = log2srcDepth;
+		} else {
+			/* But test differing depths too */
+			do {
+				log2destDepth = randLog2Depth(&rng);
+			} while (log2destDepth < tests[test].log2minDepth || log2destDepth > tests[test].log2maxDepth);
+			if (log2srcDepth < 4 || log2destDepth < 4)
+				useLookupTable = true;
+		}
+	}
+	bool overlapping = overlapTests && !mapped && !op.noSource && (fuzzRand(&rng) & 1);
+	if (overlapping)
+		log2destDepth = log2srcDepth;
+	op.src.depth = 1u << log2srcDepth;
+	op.dest.depth = 1u << log2destDepth;
+	if (useLookupTable) {
+		if (log2srcDepth < 4) {
+			op.cmMask = (1u << (1u << log2srcDepth)) - 1;
+			op.cmFlags = ColorMapPresent | ColorMapIndexedPart;
+			op.cmMaskTable = NULL;
+			op.cmShiftTable = NULL;
+		} else {
+			uint32_t cmBitsPerColor = fuzzRand(&rng) % 3 + 3;
+			op.cmMask = (1u << (cmBitsPerColor * 3)) - 1;
+			op.cmFlags = ColorMapPresent | ColorMapFixedPart | ColorMapIndexedPart;
+			if (log2srcDepth == 4) {
+				switch (cmBitsPerColor) {
+				case 3: op.cmMaskTable = &maskTable53; op.cmShiftTable = &shiftTable53; break;
+				case 4: op.cmMaskTable = &maskTable54; op.cmShiftTable = &shiftTable54; break;
+				case 5: op.cmMaskTable = NULL; op.cmShiftTable = NULL; op.cmFlags &= ~ColorMapFixedPart; break;
+				}
+			} else {
+				switch (cmBitsPerColor) {
+				case 3: op.cmMaskTable = &maskTable83; op.cmShiftTable = &shiftTable83; break;
+				case 4: op.cmMaskTable = &maskTable84; op.cmShiftTable = &shiftTable84; break;
+				case 5: op.cmMaskTable = &maskTable85; op.cmShiftTable = &shiftTable85; break;
+				}
+			}
+		}
+		op.cmLookupTable = &lookupTable[log2destDepth][(fuzzRand(&rng) % 4) == 0];
+		memcpy(&lookupTableBackup, op.cmLookupTable, sizeof lookupTableBackup);
+	} else {
+		if (log2destDepth == log2srcDepth) {
+			op.cmFlags = 0;
+			op.cmMaskTable = NULL;
+			op.cmShiftTable = NULL;
+		} else {
+			op.cmFlags = ColorMapPresent | ColorMapFixedPart;
+			if (log2srcDepth == 4) {
+				op.cmMaskTable = &maskTable58;
+				op.cmShiftTable = &shiftTable58;
+			} else {
+				op.cmMaskTable = &maskTable85;
+				op.cmShiftTable = &shiftTable85;
+			}
+		}
+		op.cmMask = 0;
+		op.cmLookupTable = NULL;
+	}
+
+	op.src.pitch = ((src_w * op.src.depth + 31) >> 3) &~ 3;
+	op.dest.pitch = ((dest_w * op.dest.depth + 31) >> 3) &~ 3;
+	/* It's believed that MSB is always true in practice */
+	if (fuzzRand(&rng) % 4 != 0) {
+		op.src.msb = op.dest.msb = true;
+	} else {
+		op.src.msb = fuzzRand(&rng) & 1;
+		op.dest.msb = fuzzRand(&rng) & 1;
+	}
+	op.width = MIN(src_w, dest_w);
+	for (uint32_t tmp = op.width, bits = 0;; tmp >>= 1, ++bits)
+	{
+	    if (tmp == 0)
+	    {
+	        op.width >>= fuzzRand(&rng) % bits;
+	        op.width &= fuzzRand(&rng);
+	        if (op.width == 0)
+	            op.width = 1;
+	        break;
+	    }
+	}
+	op.src.x = fuzzRand(&rng) % (src_w - op.width + 1);
+	op.dest.x = fuzzRand(&rng) % (dest_w - op.width + 1);
+	op.src.y = fuzzRand(&rng) % src_h;
+	op.dest.y = fuzzRand(&rng) % dest_h;
+//		memset(src, 0x55, sizeof src /*src_h * op.src.pitch*/);
+//		memset(dest, 0xAA, sizeof dest /*dest_h * op.dest.pitch*/);
+	op.height = (fuzzRand(&rng) % MIN(src_h-op.src.y, dest_h-op.dest.y)) + 1;
+	if (overlapping) {
+		intptr_t x = (intptr_t) op.dest.x + (intptr_t) (fuzzRand(&rng) % 9) - 4;
+		intptr_t y = (intptr_t) op.dest.y + (intptr_t) (fuzzRand(&rng) % 5) - 2;
+		src_w = dest_w;
+		src_h = dest_h;
+		op.src.bits = dest;
+		op.src.pitch = op.dest.pitch;
+		op.src.msb = op.dest.msb;
+		op.src.x = MIN((size_t) MAX(x, 0), dest_w - op.width);
+		op.src.y = MIN((size_t) MAX(y, 0), dest_h - op.height);
+	}
+	/* Undo the last test, then note what this one could change: the
+	 * destination rectangle with a word either side and a row above and
+	 * below, to catch overruns */
+	benchSurfaceRestore(&destSurface);
+	size_t guardPixels = 32 / op.dest.depth;
+	size_t guardLeft = MIN((size_t) op.dest.x, guardPixels);
+	size_t guardTop = MIN((size_t) op.dest.y, 1);
+	bench_rect_t guard = benchSurfaceRect(&destSurface, op.dest.pitch, op.dest.depth,
+			op.dest.x - guardLeft, op.dest.y - guardTop,
+			op.width + guardLeft + guardPixels, op.height + guardTop + 1);
+	benchSurfaceDirty(&destSurface, &guard);
+
+	if (op.combinationRule == CR_clearWord ||
+		op.combinationRule == CR_destinationWord ||
+		op.combinationRule == CR_bitInvertDestination)
+		op.noHalftone = true;
+	else
+		op.noHalftone = fuzzRand(&rng) & 1;
+	if (op.noHalftone) {
+		op.halftoneHeight = 0;
+		op.halftoneBase = NULL;
+	} else {
+		op.halftoneHeight = (fuzzRand(&rng) % 12) + 1;
+		op.halftoneBase = &halftone;
+	}
+
+	if (op.combinationRule == CR_alphaBlendConst ||
+		op.combinationRule == CR_alphaPaintConst) {
+		switch (fuzzRand(&rng) % 3) {
+		case 0: op.opt.sourceAlpha = 0; break;
+		case 1: op.opt.sourceAlpha = fuzzRand(&rng) & 0xFF; break;
+		case 2: op.opt.sourceAlpha = 0xFF; break;
+		}
+	}
+
+	if (op.combinationRule == CR_rgbComponentAlpha) {
+		op.opt.componentAlpha.componentAlphaModeColor =
+				tests[test].setComponentAlphaModeColor ? fuzzRand(&rng) & 0xFFFFFF : 0xFFFFFF;
+		op.opt.componentAlpha.componentAlphaModeAlpha =
+				tests[test].setComponentAlphaModeAlpha ? fuzzRand(&rng) & 0xFF : 0xFF;
+		if (tests[test].setGammaTables) {
+			op.opt.componentAlpha.gammaLookupTable = &gammaTable;
+			op.opt.componentAlpha.ungammaLookupTable = &ungammaTable;
+		} else {
+			op.opt.componentAlpha.gammaLookupTable = NULL;
+			op.opt.componentAlpha.ungammaLookupTable = NULL;
+		}
+	}
+
+	if (verbose >= 2) {
+		printf("Test #%zu\n", iter);
+		printf("combinationRule = %u (%s), noSource = %u\n",
+				op.combinationRule,
+				combinationRuleName[op.combinationRule],
+				op.noSource);
+		printf("source      %2"PRIuSQINT" bpp %cE, %4zu x %zu\n",
+				op.src.depth, op.src.msb ? 'B' : 'L', src_w, src_h);
+		printf("destination %2"PRIuSQINT" bpp %cE, %4zu x %zu\n",
+				op.dest.depth, op.dest.msb ? 'B' : 'L', dest_w, dest_h);
+		printf("%"PRIuSQINT",%"PRIuSQINT" -> %"PRIuSQINT",%"PRIuSQINT", size %"PRIuSQINT" x %"PRIuSQINT"\n",
+				op.src.x, op.src.y, op.dest.x, op.dest.y, op.width, op.height);
+		printf("ColorMapFixed = %u, ColorMapIndexed = %u, cmMask = 0x%"PRIXSQINT"\n",
+				!!(op.cmFlags & ColorMapFixedPart),
+				!!(op.cmFlags & ColorMapIndexedPart),
+				op.cmMask);
+		printf("noHalftone = %u, halftoneHeight = %"PRIuSQINT"\n",
+				op.noHalftone, op.halftoneHeight);
+		if (op.combinationRule == CR_alphaBlendConst ||
+			op.combinationRule == CR_alphaPaintConst)
+			printf("sourceAlpha = 0x%02"PRIXSQINT"\n", op.opt.sourceAlpha);
+		if (op.combinationRule == CR_rgbComponentAlpha)
+			printf("fixed colour = 0x%06"PRIXSQINT", fixed alpha = 0x%02"PRIXSQINT", gamma tables = %u\n",
+					op.opt.componentAlpha.componentAlphaModeColor,
+					op.opt.componentAlpha.componentAlphaModeAlpha,
+					!!op.opt.componentAlpha.gammaLookupTable);
+		if (verbose >= 3) {
+			printf("Source:\n");
+			dumpBuffer(op.src.bits, op.src.pitch / 4, src_h, log2srcDepth, op.src.msb);
+			printf("Destination:\n");
+			dumpBuffer(dest, op.dest.pitch / 4, dest_h, log2destDepth, op.dest.msb);
+		}
+	}
+
+	operation_t reference = op;
+	if (alphaBlendMapped) {
+		blit_rect_t rect = { op.src.x, op.src.y, op.dest.x, op.dest.y, op.width, op.height };
+		copyBitsDispatchBatch(&op, &rect, 1);
+	} else {
+		copyBitsDispatch(&op);
+	}
+	uint32_t crc;
+	if (crcMode == CRC_RECT) {
+		crc = rectCrc(&guard, dest_h);
+	} else {
+		crc = benchCrc32(0, dest, dest_h * op.dest.pitch);
+		if (crcMode == CRC_CROSSCHECK && rectCrc(&guard, dest_h) != crc) {
+			fprintf(stderr, "Iteration %zu: CRC of the guarded rectangle disagrees with the full CRC %08X, "
+					"so something was written outside it\n", iter, crc);
+			exit(EXIT_FAILURE);
+		}
+	}
+	uncheckedTests++;
+	if (crcMode == CRC_CROSSCHECK || differential) {
+		checkOutsideGuard(iter, &guard, dest_h + 1);
+		uncheckedTests = 0;
+	} else if (uncheckedTests == OUTSIDE_CHECK_INTERVAL) {
+		checkOutsideGuard(iter, &guard, (surfaceWords * 4 + guard.pitch - 1) / guard.pitch);
+		uncheckedTests = 0;
+	}
+	if (differential)
+		checkAgainstReference(iter, &reference, &guard);
+
+	if (verbose == 1) {
+		printf("%zu:%08X\n", iter, crc);
+	} else if (verbose >= 2) {
+		printf("Result:\n");
+		dumpBuffer(dest, op.dest.pitch / 4, dest_h, log2destDepth, op.dest.msb);
+		printf("CRC = 0x%08X\n", crc);
+		printf("\n");
+	}
+
+	if (op.cmLookupTable)
+		memcpy(op.cmLookupTable, lookupTableBackup, sizeof lookupTableBackup);
+
+	return crc;
+}
+
+/* Checkpoints fall after iterations 2^k - 1. Segment 0 holds iteration 0,
+ * and segment k > 0 holds iterations [2^(k-1), 2^k), so the cumulative CRC
+ * at checkpoint k is the XOR of the CRCs of segments 0 to k. */
+#define SEGMENTS (sizeof (size_t) * 8 + 1)
+
+static size_t segmentOf(size_t iter)
+{
+	size_t segment = 0;
+	while (iter != 0) {
+		segment++;
+		iter >>= 1;
+	}
+	return segment;
+}
+
+/* Share iterations [min_iter, max_iter) between worker processes, each with
+ * its own copy of the buffers and lookup tables, and combine the CRCs they
+ * return for each segment. Returns false if any worker failed. */
+static bool runParallel(size_t min_iter, size_t max_iter, unsigned jobs, uint32_t segmentCrc[SEGMENTS])
+{
+	pid_t pid[jobs];
+	int fd[jobs];
+	fflush(stdout);
+	fflush(stderr);
+	for (unsigned j = 0; j < jobs; j++) {
+		int p[2];
+		if (pipe(p) != 0 || (pid[j] = fork()) < 0) {
+			perror("Unable to start worker");
+			exit(EXIT_FAILURE);
+		}
+		if (pid[j] == 0) {
+			close(p[0]);
+			uint32_t partial[SEGMENTS] = { 0 };
+			/* Interleave the iterations, since their cost varies a lot */
+			for (size_t iter = min_iter + j; iter < max_iter; iter += jobs)
+				partial[segmentOf(iter)] ^= runTest(iter, 0);
+			_exit(write(p[1], partial, sizeof partial) == sizeof partial ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		close(p[1]);
+		fd[j] = p[0];
+	}
+
+	bool ok = true;
+	memset(segmentCrc, 0, SEGMENTS * sizeof *segmentCrc);
+	for (unsigned j = 0; j < jobs; j++) {
+		uint32_t partial[SEGMENTS];
+		size_t got = 0;
+		ssize_t n;
+		while (got < sizeof partial && (n = read(fd[j], (char *) partial + got, sizeof partial - got)) > 0)
+			got += n;
+		close(fd[j]);
+		int status;
+		waitpid(pid[j], &status, 0);
+		if (WIFSIGNALED(status)) {
+			fprintf(stderr, "Worker %u killed by signal %d; rerun without -j to find the iteration\n", j, WTERMSIG(status));
+			ok = false;
+		} else if (got != sizeof partial || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+			fprintf(stderr, "Worker %u failed\n", j);
+			ok = false;
+		} else {
+			for (size_t k = 0; k < SEGMENTS; k++)
+				segmentCrc[k] ^= partial[k];
+		}
+	}
+	return ok;
+}
+
+/* Reference CRCs after the first 2^k iterations, for each surface geometry
+ * they have been recorded for. All were made with the legacy generator. */
+#define CHECKPOINTS (21)
+
+static const struct {
+	size_t   maxWidth;
+	size_t   maxHeight;
+	uint32_t crc[CHECKPOINTS];
+} checkTables[] = {
+	{ MAXWIDTH, MAXHEIGHT, {
             0xB7433DE2, // first 1
             0xFA78A988, // first 2
             0x15F9C12A, // first 4
@@ -392,19 +834,75 @@ int main(int argc, char *argv[])
             0x0B159E68, // first 262144
             0x110988A4, // first 524288
             0x7BB202D5, // first 1048576
-	};
+	} },
+};
+
+static const uint32_t *findCheckTable(void)
+{
+	if (randKind != FUZZ_RAND_LEGACY || alphaBlendMapped || overlapTests)
+		return NULL;
+	for (size_t i = 0; i < sizeof checkTables / sizeof *checkTables; i++)
+		if (checkTables[i].maxWidth == maxWidth && checkTables[i].maxHeight == maxHeight)
+			return checkTables[i].crc;
+	return NULL;
+}
+
+/* Compare the cumulative CRC after the first n iterations with the reference
+ * value. Where there is no reference, the CRC is printed instead, in the form
+ * used by checkTables, so that one can be added from a trusted build. */
+static bool checkpoint(const uint32_t *check_table, size_t index, size_t n, uint32_t crc)
+{
+	if (check_table == NULL) {
+		printf("0x%08X, // first %zu\n", crc, n);
+		return true;
+	}
+	uint32_t expected = check_table[index];
+	if (crc != expected) {
+		fprintf(stderr, "Error found before iteration %7zu: cumulative CRC %08X should be %08X\n", n, crc, expected);
+		return false;
+	}
+	return true;
+}
+
+void warning(const char *message)
+{
+    (void) message;
+//    fprintf(stderr, "warning: %s\n", message);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t min_iter = 0;
+	size_t max_iter = 1048576;
+	bool help = false;
+	uint32_t verbose = 0;
+	unsigned jobs = 1;
+
+	bool check = true;
+	uint32_t cumulative_crc = 0;
+	size_t check_index = 0;
 	bool failed = false;
 
 	int opt;
-	while ((opt = getopt(argc, argv, "hm:v")) != -1) {
+	while ((opt = getopt(argc, argv, "adfhj:m:orvxW:H:")) != -1) {
 		switch (opt) {
+		case 'a': alphaBlendMapped = true; differential = true; break;
+		case 'd': differential = true; break;
+		case 'f': randKind = FUZZ_RAND_FAST; break;
 		case 'h': help = true; break;
+		case 'W': maxWidth = atoi(optarg); break;
+		case 'H': maxHeight = atoi(optarg); break;
+		case 'j': jobs = atoi(optarg); break;
 		case 'm': max_iter = atoi(optarg); break;
+		case 'o': overlapTests = true; differential = true; break;
+		case 'r': crcMode = CRC_RECT; break;
+		case 'x': crcMode = CRC_CROSSCHECK; break;
 		case 'v': verbose++; break;
 		}
 	}
-	if (help || optind < argc-1) {
-		fprintf(stderr, "Syntax: %s [-h] [-m max_iterations] [-v] [-v] [-v] [iteration]\n", argv[0]);
+	if (help || optind < argc-1 ||
+			maxWidth < 1 || maxWidth > LIMITWIDTH || maxHeight < 1 || maxHeight > LIMITHEIGHT) {
+		fprintf(stderr, "Syntax: %s [-h] [-a] [-d] [-f] [-o] [-r|-x] [-j jobs] [-m max_iterations] [-W max_width] [-H max_height] [-v] [-v] [-v] [iteration]\n", argv[0]);
 		exit(EXIT_FAILURE);
 	}
 	if (optind == argc-1) {
@@ -413,249 +911,98 @@ int main(int argc, char *argv[])
 		verbose = MAX(verbose,2);
 		check = false;
 	}
+	if (jobs == 0)
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	if (jobs > 1 && verbose) {
+		/* Per-iteration output would come out in no particular order */
+		fprintf(stderr, "warning: -j ignored with -v\n");
+		jobs = 1;
+	}
+
+	/* Without reference CRCs, a run would validate nothing, so check every
+	 * test against the generic code instead */
+	const uint32_t *check_table = findCheckTable();
+	if (check && check_table == NULL && !differential) {
+		fprintf(stderr, "No reference CRCs for these options, so checking against the generic code (-d)\n");
+		differential = true;
+	}
 
 	initialiseCopyBits();
+#ifdef __x86_64__
+	addX64FastPaths();
+#endif
 	initialiseModule();
 
 	/* Initialise the lookup tables */
-	srand(0);
+	fuzz_rand_t rng;
+	fuzzRandSeed(&rng, randKind, 0);
 	for (uint32_t log2bpp = 0; log2bpp < 6; log2bpp++){
 		uint32_t mask = (1ul << (1u << log2bpp)) - 1;
 		for (uint32_t entry = 0; entry < 32768; entry++)
 		{
-			uint32_t val = rand();
+			uint32_t val = fuzzRand(&rng);
 			if (log2bpp == 5)
-				val ^= rand() << 16;
+				val ^= fuzzRand(&rng) << 16;
 			val &= mask;
 			lookupTable[log2bpp][0][entry] = val;
 			lookupTable[log2bpp][1][entry] = lookupTable[log2bpp][0][!!entry];
 		}
 	}
 	for (uint32_t i = 0; i < 256; i++) {
-		gammaTable[i] = rand();
-		ungammaTable[i] = rand();
-	}
-
-	static uint32_t src[MAXWIDTH * MAXHEIGHT];
-	static uint32_t dest[MAXWIDTH * MAXHEIGHT];
-	static uint32_t dest_init[MAXWIDTH * MAXHEIGHT];
-	fillWithRand(src, sizeof src / sizeof *src);
-	fillWithRand(dest_init, sizeof dest_init / sizeof *dest_init);
-
-	size_t iter;
-	for (iter = min_iter; iter < max_iter; iter++) {
-		srand(iter ^ (iter << 16));
-
-		size_t src_w = rand() % MAXWIDTH + 1;
-		size_t src_h = rand() % MAXHEIGHT + 1;
-		size_t dest_w = rand() % MAXWIDTH + 1;
-		size_t dest_h = rand() % MAXHEIGHT + 1;
-
-		size_t test = rand() % (sizeof tests / sizeof *tests);
-		operation_t op;
-		op.combinationRule = tests[test].cr;
-		op.noSource = tests[test].noSource;
-		op.src.bits = src;
-		op.dest.bits = dest;
-
-		bool useLookupTable = rand() & 1;
-		uint32_t log2srcDepth, log2destDepth;
-		if (tests[test].log2minDepth == tests[test].log2maxDepth) {
-			/* Only one depth supported */
-			log2srcDepth = log2destDepth = tests[test].log2minDepth;
-		} else {
-			do {
-				log2srcDepth = randLog2Depth();
-			} while (log2srcDepth < tests[test].log2minDepth || log2srcDepth > tests[test].log2maxDepth);
-			if (rand() & 1) {
-				/* More likely to have matching depths */
-				log2destDepth = log2srcDepth;
-			} else {
-				/* But test differing depths too */
-				do {
-					log2destDepth = randLog2Depth();
-				} while (log2destDepth < tests[test].log2minDepth || log2destDepth > tests[test].log2maxDepth);
-				if (log2srcDepth < 4 || log2destDepth < 4)
-					useLookupTable = true;
-			}
-		}
-		op.src.depth = 1u << log2srcDepth;
-		op.dest.depth = 1u << log2destDepth;
-		if (useLookupTable) {
-			if (log2srcDepth < 4) {
-				op.cmMask = (1u << (1u << log2srcDepth)) - 1;
-				op.cmFlags = ColorMapPresent | ColorMapIndexedPart;
-				op.cmMaskTable = NULL;
-				op.cmShiftTable = NULL;
-			} else {
-				uint32_t cmBitsPerColor = rand() % 3 + 3;
-				op.cmMask = (1u << (cmBitsPerColor * 3)) - 1;
-				op.cmFlags = ColorMapPresent | ColorMapFixedPart | ColorMapIndexedPart;
-				if (log2srcDepth == 4) {
-					switch (cmBitsPerColor) {
-					case 3: op.cmMaskTable = &maskTable53; op.cmShiftTable = &shiftTable53; break;
-					case 4: op.cmMaskTable = &maskTable54; op.cmShiftTable = &shiftTable54; break;
-					case 5: op.cmMaskTable = NULL; op.cmShiftTable = NULL; op.cmFlags &= ~ColorMapFixedPart; break;
-					}
-				} else {
-					switch (cmBitsPerColor) {
-					case 3: op.cmMaskTable = &maskTable83; op.cmShiftTable = &shiftTable83; break;
-					case 4: op.cmMaskTable = &maskTable84; op.cmShiftTable = &shiftTable84; break;
-					case 5: op.cmMaskTable = &maskTable85; op.cmShiftTable = &shiftTable85; break;
-					}
-				}
-			}
-			op.cmLookupTable = &lookupTable[log2destDepth][(rand() % 4) == 0];
-			memcpy(&lookupTableBackup, op.cmLookupTable, sizeof lookupTableBackup);
-		} else {
-			if (log2destDepth == log2srcDepth) {
-				op.cmFlags = 0;
-				op.cmMaskTable = NULL;
-				op.cmShiftTable = NULL;
-			} else {
-				op.cmFlags = ColorMapPresent | ColorMapFixedPart;
-				if (log2srcDepth == 4) {
-					op.cmMaskTable = &maskTable58;
-					op.cmShiftTable = &shiftTable58;
-				} else {
-					op.cmMaskTable = &maskTable85;
-					op.cmShiftTable = &shiftTable85;
-				}
-			}
-			op.cmMask = 0;
-			op.cmLookupTable = NULL;
-		}
-
-		op.src.pitch = ((src_w * op.src.depth + 31) >> 3) &~ 3;
-		op.dest.pitch = ((dest_w * op.dest.depth + 31) >> 3) &~ 3;
-		/* It's believed that MSB is always true in practice */
-		if (rand() % 4 != 0) {
-			op.src.msb = op.dest.msb = true;
-		} else {
-			op.src.msb = rand() & 1;
-			op.dest.msb = rand() & 1;
-		}
-		op.width = MIN(src_w, dest_w);
-		for (uint32_t tmp = op.width, bits = 0;; tmp >>= 1, ++bits)
-		{
-		    if (tmp == 0)
-		    {
-		        op.width >>= rand() % bits;
-		        op.width &= rand();
-		        if (op.width == 0)
-		            op.width = 1;
-		        break;
-		    }
-		}
-		op.src.x = rand() % (src_w - op.width + 1);
-		op.dest.x = rand() % (dest_w - op.width + 1);
-		op.src.y = rand() % src_h;
-		op.dest.y = rand() % dest_h;
-//		memset(src, 0x55, sizeof src /*src_h * op.src.pitch*/);
-//		memset(dest, 0xAA, sizeof dest /*dest_h * op.dest.pitch*/);
-		memcpy(dest, dest_init, sizeof dest);
-		op.height = (rand() % MIN(src_h-op.src.y, dest_h-op.dest.y)) + 1;
-
-		if (op.combinationRule == CR_clearWord ||
-			op.combinationRule == CR_destinationWord ||
-			op.combinationRule == CR_bitInvertDestination)
-			op.noHalftone = true;
-		else
-			op.noHalftone = rand() & 1;
-		if (op.noHalftone) {
-			op.halftoneHeight = 0;
-			op.halftoneBase = NULL;
-		} else {
-			op.halftoneHeight = (rand() % 12) + 1;
-			op.halftoneBase = &halftone;
-		}
-
-		if (op.combinationRule == CR_alphaBlendConst ||
-			op.combinationRule == CR_alphaPaintConst) {
-			switch (rand() % 3) {
-			case 0: op.opt.sourceAlpha = 0; break;
-			case 1: op.opt.sourceAlpha = rand() & 0xFF; break;
-			case 2: op.opt.sourceAlpha = 0xFF; break;
-			}
-		}
-
-		if (op.combinationRule == CR_rgbComponentAlpha) {
-			op.opt.componentAlpha.componentAlphaModeColor =
-					tests[test].setComponentAlphaModeColor ? rand() & 0xFFFFFF : 0xFFFFFF;
-			op.opt.componentAlpha.componentAlphaModeAlpha =
-					tests[test].setComponentAlphaModeAlpha ? rand() & 0xFF : 0xFF;
-			if (tests[test].setGammaTables) {
-				op.opt.componentAlpha.gammaLookupTable = &gammaTable;
-				op.opt.componentAlpha.ungammaLookupTable = &ungammaTable;
-			} else {
-				op.opt.componentAlpha.gammaLookupTable = NULL;
-				op.opt.componentAlpha.ungammaLookupTable = NULL;
-			}
-		}
-
-		if (verbose >= 2) {
-			printf("Test #%zu\n", iter);
-			printf("combinationRule = %u (%s), noSource = %u\n",
-					op.combinationRule,
-					combinationRuleName[op.combinationRule],
-					op.noSource);
-			printf("source      %2"PRIuSQINT" bpp %cE, %4zu x %zu\n",
-					op.src.depth, op.src.msb ? 'B' : 'L', src_w, src_h);
-			printf("destination %2"PRIuSQINT" bpp %cE, %4zu x %zu\n",
-					op.dest.depth, op.dest.msb ? 'B' : 'L', dest_w, dest_h);
-			printf("%"PRIuSQINT",%"PRIuSQINT" -> %"PRIuSQINT",%"PRIuSQINT", size %"PRIuSQINT" x %"PRIuSQINT"\n",
-					op.src.x, op.src.y, op.dest.x, op.dest.y, op.width, op.height);
-			printf("ColorMapFixed = %u, ColorMapIndexed = %u, cmMask = 0x%"PRIXSQINT"\n",
-					!!(op.cmFlags & ColorMapFixedPart),
-					!!(op.cmFlags & ColorMapIndexedPart),
-					op.cmMask);
-			printf("noHalftone = %u, halftoneHeight = %"PRIuSQINT"\n",
-					op.noHalftone, op.halftoneHeight);
-			if (op.combinationRule == CR_alphaBlendConst ||
-				op.combinationRule == CR_alphaPaintConst)
-				printf("sourceAlpha = 0x%02"PRIXSQINT"\n", op.opt.sourceAlpha);
-			if (op.combinationRule == CR_rgbComponentAlpha)
-				printf("fixed colour = 0x%06"PRIXSQINT", fixed alpha = 0x%02"PRIXSQINT", gamma tables = %u\n",
-						op.opt.componentAlpha.componentAlphaModeColor,
-						op.opt.componentAlpha.componentAlphaModeAlpha,
-						!!op.opt.componentAlpha.gammaLookupTable);
-			if (verbose >= 3) {
-				printf("Source:\n");
-				dumpBuffer(src, op.src.pitch / 4, src_h, log2srcDepth, op.src.msb);
-				printf("Destination:\n");
-				dumpBuffer(dest, op.dest.pitch / 4, dest_h, log2destDepth, op.dest.msb);
-			}
-		}
+		gammaTable[i] = fuzzRand(&rng);
+		ungammaTable[i] = fuzzRand(&rng);
+	}
 
-		copyBitsDispatch(&op);
-		uint32_t crc = compute_crc32(0, dest, dest_h * op.dest.pitch);
+	surfaceWords = maxWidth * maxHeight;
+	if (!benchSurfaceCreate(&srcSurface, surfaceWords * 4, false) ||
+			!benchSurfaceCreate(&destSurface, surfaceWords * 4, true) ||
+			(differential && !benchSurfaceCreate(&refSurface, surfaceWords * 4, true))) {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	src = srcSurface.bits;
+	dest = destSurface.bits;
+	fuzzRandFill(&rng, FUZZ_RUNS_LONG, src, surfaceWords);
+	fuzzRandFill(&rng, FUZZ_RUNS_LONG, dest, surfaceWords);
+	benchSurfaceSnapshot(&destSurface);
+	if (crcMode != CRC_FULL)
+		buildPristinePrefix();
+	if (differential) {
+		dest_ref = refSurface.bits;
+		memcpy(dest_ref, dest, surfaceWords * 4);
+		benchSurfaceSnapshot(&refSurface);
+	}
 
-		if (verbose == 1) {
-			printf("%zu:%08X\n", iter, crc);
-		} else if (verbose >= 2) {
-			printf("Result:\n");
-			dumpBuffer(dest, op.dest.pitch / 4, dest_h, log2destDepth, op.dest.msb);
-			printf("CRC = 0x%08X\n", crc);
-			printf("\n");
+	if (check && check_table == NULL)
+		printf("No reference CRCs for these options. Checkpoint CRCs are:\n");
+
+	if (jobs > 1) {
+		uint32_t segmentCrc[SEGMENTS];
+		bool workersOk = runParallel(min_iter, max_iter, jobs, segmentCrc);
+		for (; workersOk && check_index < CHECKPOINTS &&
+				((size_t) 1 << check_index) <= max_iter; check_index++) {
+			cumulative_crc ^= segmentCrc[check_index];
+			if (!checkpoint(check_table, check_index, (size_t) 1 << check_index, cumulative_crc))
+				failed = true;
 		}
-
-		if (check) {
-			cumulative_crc ^= crc;
-			if (check_index < sizeof check_table / sizeof *check_table &&
-					(iter & (iter+1)) == 0) {
-				if (cumulative_crc != check_table[check_index])
-				{
-					failed = true;
-					fprintf(stderr, "Error found before iteration %7zu: cumulative CRC %08X should be %08X\n", iter+1, cumulative_crc, check_table[check_index]);
+		if (!workersOk)
+			failed = true;
+	} else {
+		for (size_t iter = min_iter; iter < max_iter; iter++) {
+			uint32_t crc = runTest(iter, verbose);
+
+			if (check) {
+				cumulative_crc ^= crc;
+				if (check_index < CHECKPOINTS &&
+						(iter & (iter+1)) == 0) {
+					if (!checkpoint(check_table, check_index, iter+1, cumulative_crc))
+						failed = true;
+					check_index++;
 				}
-				check_index++;
 			}
 		}
-
-		if (op.cmLookupTable)
-			memcpy(op.cmLookupTable, lookupTableBackup, sizeof lookupTableBackup);
 	}
-	if (check && !failed)
+	if (check && !failed && (check_table != NULL || differential))
 		printf("Passes checks OK\n");
 	exit(check && failed ? EXIT_FAILURE : EXIT_SUCCESS);
 }
@@ -29,23 +29,38 @@
 #include <string.h>
 
 #include <getopt.h>
-#include <sys/time.h>
 
 #include "BitBltDispatch.h"
+#include "BenchTiming.h"
+#include "BenchReport.h"
+#include "BenchCrc.h"
+#include "BenchSurface.h"
+#include "FuzzRand.h"
+#ifdef __x86_64__
+#include "BitBltX64.h"
+#endif
 
 #define sqInt int
 
-#define MIN(a,b) ((a)<(b)?(a):(b))
-
 #define SCREENWIDTH (1920)
 #define SCREENHEIGHT (1080)
 #define SPRITEWIDTH (1500)
 
 extern sqInt initialiseModule(void);
 
-static uint32_t screen[SCREENWIDTH * SCREENHEIGHT];
-static uint32_t sprite_in[SPRITEWIDTH * SCREENHEIGHT];
-static uint32_t sprite_out[SPRITEWIDTH * SCREENHEIGHT];
+#define SCREENBYTES (SCREENWIDTH * SCREENHEIGHT * 4)
+#define SPRITEBYTES (SPRITEWIDTH * SCREENHEIGHT * 4)
+
+static uint32_t *screen;
+static uint32_t *sprite_in;
+static uint32_t *sprite_out;
+
+static int format = REPORT_TEXT;
+static const struct option longOptions[] = {
+	{ "csv",  no_argument, &format, REPORT_CSV  },
+	{ "json", no_argument, &format, REPORT_JSON },
+	{ NULL,   0,           NULL,    0           },
+};
 
 static const struct {
 	const char *string;
@@ -90,112 +105,6 @@ static const struct {
 	{ "rgbComponentAlpha",    CR_rgbComponentAlpha,    },
 };
 
-/* Public domain CRC function */
-static uint32_t compute_crc32 (uint32_t in_crc32, const void *buf, size_t buf_len)
-{
-    static const uint32_t crc_table[256] = {
-	0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F,
-	0xE963A535, 0x9E6495A3, 0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
-	0x09B64C2B, 0x7EB17CBD,	0xE7B82D07, 0x90BF1D91, 0x1DB71064, 0x6AB020F2,
-	0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
-	0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC,	0x14015C4F, 0x63066CD9,
-	0xFA0F3D63, 0x8D080DF5, 0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
-	0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C,
-	0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
-	0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423,
-	0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
-	0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D, 0x76DC4190, 0x01DB7106,
-	0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-	0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D,
-	0x91646C97, 0xE6635C01, 0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
-	0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950,
-	0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
-	0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7,
-	0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
-	0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9, 0x5005713C, 0x270241AA,
-	0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
-	0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81,
-	0xB7BD5C3B, 0xC0BA6CAD, 0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
-	0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683, 0xE3630B12, 0x94643B84,
-	0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-	0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB,
-	0x196C3671, 0x6E6B06E7, 0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
-	0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5, 0xD6D6A3E8, 0xA1D1937E,
-	0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
-	0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55,
-	0x316E8EEF, 0x4669BE79, 0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
-	0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28,
-	0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
-	0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F,
-	0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
-	0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21, 0x86D3D2D4, 0xF1D4E242,
-	0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-	0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69,
-	0x616BFFD3, 0x166CCF45, 0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
-	0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC,
-	0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
-	0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693,
-	0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
-	0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
-    };
-
-    uint32_t              crc32;
-    unsigned char *       byte_buf;
-    size_t                i;
-
-    /* accumulate crc32 for buffer */
-    crc32 = in_crc32 ^ 0xFFFFFFFF;
-    byte_buf = (unsigned char*) buf;
-
-    for (i = 0; i < buf_len; i++)
-	crc32 = (crc32 >> 8) ^ crc_table[(crc32 ^ byte_buf[i]) & 0xFF];
-
-    return (crc32 ^ 0xFFFFFFFF);
-}
-
-static uint64_t gettime(void)
-{
-	struct timeval tv;
-
-	gettimeofday (&tv, NULL);
-	return tv.tv_sec * 1000000 + tv.tv_usec;
-}
-
-static void fillWithRand(uint32_t *buf, size_t nWords)
-{
-	/* Fill a block with random data, but prefer runs of all 1 or 0 */
-	size_t totalRemain = nWords * 32;
-	uint32_t word = 0;
-	size_t wordRemain = 32;
-	do {
-		enum {
-			FILL_ZEROS,
-			FILL_RAND,
-			FILL_ONES
-		} blockType = rand() % 3;
-		size_t blockRemain = rand() % 64 + 1;
-		blockRemain = MIN(blockRemain, totalRemain);
-		do {
-			size_t bitsThisTime = MIN(blockRemain, wordRemain);
-			if (blockType == FILL_RAND && bitsThisTime > 16)
-				bitsThisTime = 16;
-			word = bitsThisTime == 32 ? 0 : word << bitsThisTime;
-			if (blockType == FILL_ONES) {
-				word |= (1ul << bitsThisTime) - 1;
-			} else if (blockType == FILL_RAND) {
-				word |= rand() & ((1ul << bitsThisTime) - 1);
-			}
-			totalRemain -= bitsThisTime;
-			blockRemain -= bitsThisTime;
-			wordRemain -= bitsThisTime;
-			if (wordRemain == 0) {
-				*buf++ = word;
-				wordRemain = 32;
-			}
-		} while (blockRemain > 0);
-	} while (totalRemain > 0);
-}
-
 static void copy(void *from, uint32_t from_stride, uint32_t from_x, uint32_t from_y, void *to, uint32_t to_stride, uint32_t to_x, uint32_t to_y, uint32_t d, uint32_t w, uint32_t h)
 {
 	operation_t op;
@@ -237,16 +146,20 @@ int main(int argc, char *argv[])
 {
 	uint64_t t1, t2, t3;
 	operation_t op;
+	int cpu = -1;
 
 	bool help = false;
 	int opt;
-	while ((opt = getopt(argc, argv, "h")) != -1) {
+	while ((opt = getopt_long(argc, argv, "hp:c:", longOptions, NULL)) != -1) {
 		switch (opt) {
+		case '?': help = true; break;
 		case 'h': help = true; break;
+		case 'p': cpu = atoi(optarg); break;
+		case 'c': benchSetConfidence(atof(optarg) / 100); break;
 		}
 	}
 	if (help || optind > argc - 2) {
-		fprintf(stderr, "Syntax: %s [-h] combinationRule depth\n", argv[0]);
+		fprintf(stderr, "Syntax: %s [-h] [-p cpu] [-c confidence percent] [--csv|--json] combinationRule depth\n", argv[0]);
 		exit(EXIT_SUCCESS);
 	}
 	size_t i;
@@ -267,16 +180,31 @@ int main(int argc, char *argv[])
 	}
 	op.dest.depth = op.src.depth;
 
+	if (cpu >= 0 && !benchPinCpu(cpu))
+		exit(EXIT_FAILURE);
+
 	initialiseCopyBits();
+#ifdef __x86_64__
+	addX64FastPaths();
+#endif
 	initialiseModule();
 
+	screen = benchSurfaceAlloc(SCREENBYTES);
+	sprite_in = benchSurfaceAlloc(SPRITEBYTES);
+	sprite_out = benchSurfaceAlloc(SPRITEBYTES);
+	if (screen == NULL || sprite_in == NULL || sprite_out == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
 	/* Put the same random data in the input and output sprite buffers.
 	 * This makes it trivial to compare the before and after state,
 	 * even when the sprite doesn't use the whole buffer. */
-	srand(0);
-	fillWithRand(sprite_in, sizeof sprite_in / 4);
-	memcpy(sprite_out, sprite_in, sizeof sprite_in);
-	memset(screen, 0, sizeof screen);
+	fuzz_rand_t rng;
+	fuzzRandSeed(&rng, FUZZ_RAND_LEGACY, 0);
+	fuzzRandFill(&rng, FUZZ_RUNS_SHORT, sprite_in, SPRITEBYTES / 4);
+	memcpy(sprite_out, sprite_in, SPRITEBYTES);
+	memset(screen, 0, SCREENBYTES);
 
 	uint32_t screen_stride = (SCREENWIDTH * op.src.depth + 31) / 8 &~ 3;
 	uint32_t sprite_stride = (SPRITEWIDTH * op.src.depth + 31) / 8 &~ 3;
@@ -303,31 +231,74 @@ int main(int argc, char *argv[])
 
 	copy(sprite_in, sprite_stride, 0, 0, screen, screen_stride, 0, 0, op.src.depth, SPRITEWIDTH, SCREENHEIGHT);
 
-	t1 = gettime();
+	/* Each sample sweeps the sprite right and then back left again, leaving
+	 * the screen as it was, so the result is independent of sample count */
+	bench_sampler_t right, left;
+	benchSamplerInit(&right);
+	benchSamplerInit(&left);
+	do {
+		t1 = benchTimeNow();
+
+		for (uint32_t x = 0; x < SCREENWIDTH-SPRITEWIDTH; x++) {
+			op.src.x = x;
+			op.dest.x = x + 1;
+			copyBitsDispatch(&op);
+		}
 
-	for (uint32_t x = 0; x < SCREENWIDTH-SPRITEWIDTH; x++) {
-		op.src.x = x;
-		op.dest.x = x + 1;
-		copyBitsDispatch(&op);
-	}
+		t2 = benchTimeNow();
 
-	t2 = gettime();
+		for (uint32_t x = SCREENWIDTH-SPRITEWIDTH; x > 0 ; x--) {
+			op.src.x = x;
+			op.dest.x = x - 1;
+			copyBitsDispatch(&op);
+		}
 
-	for (uint32_t x = SCREENWIDTH-SPRITEWIDTH; x > 0 ; x--) {
-		op.src.x = x;
-		op.dest.x = x - 1;
-		copyBitsDispatch(&op);
-	}
+		t3 = benchTimeNow();
+
+		benchSamplerAdd(&right, t2 - t1);
+		benchSamplerAdd(&left, t3 - t2);
+	} while (!benchSamplerDone(&right) || !benchSamplerDone(&left));
 
-	t3 = gettime();
+	bench_stats_t rightStats, leftStats;
+	benchSamplerStats(&right, &rightStats);
+	benchSamplerStats(&left, &leftStats);
 
 	copy(screen, screen_stride, 0, 0, sprite_out, sprite_stride, 0, 0, op.src.depth, SPRITEWIDTH, SCREENHEIGHT);
 
 	uint64_t bytesPerBlt = SPRITEWIDTH * SCREENHEIGHT * op.src.depth / 8 ;
-	printf("Dest to the right of src (overlap):   %6.2f\n", (double) bytesPerBlt * (SCREENWIDTH-SPRITEWIDTH) / (t2 - t1));
-	printf("Dest to the left of src (no overlap): %6.2f\n", (double) bytesPerBlt * (SCREENWIDTH-SPRITEWIDTH) / (t3 - t2));
-	uint32_t crc = compute_crc32(0, sprite_out, sizeof sprite_out);
-	printf("CRC of result = 0x%08X (%s input)\n", crc, memcmp(sprite_in, sprite_out, sizeof sprite_out) == 0 ? "same as" : "different from");
+	double bytesPerSweep = 1000.0 * bytesPerBlt * (SCREENWIDTH-SPRITEWIDTH);
+	uint32_t crc = benchCrc32(0, sprite_out, SPRITEBYTES);
+	bool same = memcmp(sprite_in, sprite_out, SPRITEBYTES) == 0;
+	if (format == REPORT_TEXT) {
+		printf("                                      Median, Min,    P95\n");
+		printf("Dest to the right of src (overlap):   %6.2f, %6.2f, %6.2f\n", bytesPerSweep / rightStats.median, bytesPerSweep / rightStats.min, bytesPerSweep / rightStats.p95);
+		printf("Dest to the left of src (no overlap): %6.2f, %6.2f, %6.2f\n", bytesPerSweep / leftStats.median, bytesPerSweep / leftStats.min, bytesPerSweep / leftStats.p95);
+		printf("CRC of result = 0x%08X (%s input)\n", crc, same ? "same as" : "different from");
+	} else {
+		report_record_t record;
+		record.rule = argv[optind];
+		record.srcDepth = op.src.depth;
+		record.destDepth = op.dest.depth;
+		record.colorMap = "none";
+		record.halftone = false;
+		record.mblits = -1;
+		record.perPixel = NULL;
+		reportBegin(format, "overlap");
+		record.test = "Overlap";
+		record.median = bytesPerSweep / rightStats.median;
+		record.min = bytesPerSweep / rightStats.min;
+		record.p95 = bytesPerSweep / rightStats.p95;
+		record.samples = rightStats.samples;
+		reportRecord(&record);
+		record.test = "NoOverlap";
+		record.median = bytesPerSweep / leftStats.median;
+		record.min = bytesPerSweep / leftStats.min;
+		record.p95 = bytesPerSweep / leftStats.p95;
+		record.samples = leftStats.samples;
+		reportRecord(&record);
+		reportEnd();
+		fprintf(stderr, "CRC of result = 0x%08X (%s input)\n", crc, same ? "same as" : "different from");
+	}
 
 	exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,290 @@
+/*
+ * Copyright © 2026 RISC OS Open Ltd
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific, written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
+ * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+ * SOFTWARE.
+ *
+ */
+
+/* Replay a trace recorded with BITBLT_TRACE against synthetic surfaces, and
+ * report where the time goes, rule by rule. */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <getopt.h>
+
+#include "BitBltDispatch.h"
+#include "BitBltTrace.h"
+#include "BenchTiming.h"
+#include "FuzzRand.h"
+#ifdef __x86_64__
+#include "BitBltX64.h"
+#endif
+
+#define sqInt int
+
+#define DEFAULT_ITERATIONS (5)
+
+extern sqInt initialiseModule(void);
+
+static const char *const combinationRuleName[] = {
+		"clearWord",
+		"bitAnd",
+		"bitAndInvert",
+		"sourceWord",
+		"bitInvertAnd",
+		"destinationWord",
+		"bitXor",
+		"bitOr",
+		"bitInvertAndInvert",
+		"bitInvertXor",
+		"bitInvertDestination",
+		"bitOrInvert",
+		"bitInvertSource",
+		"bitInvertOr",
+		"bitInvertOrInvert",
+		"destinationWord_alt1",
+		"destinationWord_alt2",
+		"destinationWord_alt3",
+		"addWord",
+		"subWord",
+		"rgbAdd",
+		"rgbSub",
+		"OLDrgbDiff",
+		"OLDtallyIntoMap",
+		"alphaBlend",
+		"pixPaint",
+		"pixMask",
+		"rgbMax",
+		"rgbMin",
+		"rgbMinInvert",
+		"alphaBlendConst",
+		"alphaPaintConst",
+		"rgbDiff",
+		"tallyIntoMap",
+		"alphaBlendScaled",
+		"alphaBlendScaled_alt1",
+		"alphaBlendScaled_alt2",
+		"rgbMul",
+		"pixSwap",
+		"pixClear",
+		"fixAlpha",
+		"rgbComponentAlpha",
+};
+
+static const char *const matchRuleName[] = {
+		"pixelMatch",
+		"notAnotB",
+		"notAmatchB",
+};
+
+#define COPY_RULES (sizeof combinationRuleName / sizeof *combinationRuleName)
+#define MATCH_RULES (sizeof matchRuleName / sizeof *matchRuleName)
+
+typedef struct {
+	uint64_t calls;
+	uint64_t pixels;
+	uint64_t ns;
+} totals_t;
+
+/* Copy rules first, then compare rules */
+static totals_t totals[COPY_RULES + MATCH_RULES];
+
+/* The cost of the pair of clock reads that surround each operation, which is
+ * comparable with the cost of the smallest blits */
+static uint64_t timerOverhead(void)
+{
+	bench_sampler_t s;
+	bench_stats_t stats;
+	benchSamplerInit(&s);
+	do {
+		uint64_t t1 = benchTimeNow();
+		uint64_t t2 = benchTimeNow();
+		benchSamplerAdd(&s, t2 - t1);
+	} while (!benchSamplerDone(&s));
+	benchSamplerStats(&s, &stats);
+	return stats.min;
+}
+
+static void replay(trace_t *trace, uint64_t overhead, bool timed)
+{
+	for (size_t i = 0; i < trace->count; i++) {
+		trace_record_t *r = &trace->records[i];
+		uint64_t t1 = benchTimeNow();
+		if (r->compare)
+			(void) compareColorsDispatch(&r->op.compare);
+		else
+			copyBitsDispatch(&r->op.copy);
+		uint64_t t2 = benchTimeNow();
+		if (timed) {
+			totals_t *t;
+			uint64_t pixels;
+			if (r->compare) {
+				t = &totals[COPY_RULES + r->op.compare.matchRule];
+				pixels = (uint64_t) r->op.compare.width * r->op.compare.height;
+			} else {
+				t = &totals[r->op.copy.combinationRule];
+				pixels = (uint64_t) r->op.copy.width * r->op.copy.height;
+			}
+			t->calls++;
+			t->pixels += pixels;
+			t->ns += t2 - t1 > overhead ? t2 - t1 - overhead : 0;
+		}
+	}
+}
+
+void warning(const char *message)
+{
+    (void) message;
+//    fprintf(stderr, "warning: %s\n", message);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned iterations = DEFAULT_ITERATIONS;
+	int cpu = -1;
+
+	bool help = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "hi:p:")) != -1) {
+		switch (opt) {
+		case '?': help = true; break;
+		case 'h': help = true; break;
+		case 'i': iterations = atoi(optarg); break;
+		case 'p': cpu = atoi(optarg); break;
+		}
+	}
+	if (help || optind != argc - 1 || iterations == 0) {
+		fprintf(stderr, "Syntax: %s [-h] [-i iterations] [-p cpu] trace\n", argv[0]);
+		exit(EXIT_SUCCESS);
+	}
+
+	trace_t trace;
+	if (!bitBltTraceLoad(argv[optind], &trace))
+		exit(EXIT_FAILURE);
+	for (size_t i = 0; i < trace.count; i++) {
+		trace_record_t *r = &trace.records[i];
+		if (r->compare ? r->op.compare.matchRule >= MATCH_RULES : r->op.copy.combinationRule >= COPY_RULES) {
+			fprintf(stderr, "Unrecognised rule in operation %zu\n", i);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (cpu >= 0 && !benchPinCpu(cpu))
+		exit(EXIT_FAILURE);
+
+	initialiseCopyBits();
+#ifdef __x86_64__
+	addX64FastPaths();
+#endif
+	initialiseModule();
+
+	/* Only the shape of each surface is known, so fill them with the same
+	 * sort of data as the other harnesses use */
+	fuzz_rand_t rng;
+	fuzzRandSeed(&rng, FUZZ_RAND_LEGACY, 0);
+	uint32_t **surface = calloc(trace.surfaceCount, sizeof *surface);
+	size_t surfaceBytes = 0;
+	if (surface == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	for (size_t i = 0; i < trace.surfaceCount; i++) {
+		size_t words = (trace.surfaceBytes[i] + 3) / 4 + 1;
+		surface[i] = malloc(words * 4);
+		if (surface[i] == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+		fuzzRandFill(&rng, FUZZ_RUNS_SHORT, surface[i], words);
+		surfaceBytes += words * 4;
+	}
+	for (size_t i = 0; i < trace.count; i++) {
+		trace_record_t *r = &trace.records[i];
+		if (r->compare) {
+			r->op.compare.srcA.bits = surface[r->srcSurface];
+			r->op.compare.srcB.bits = surface[r->destSurface];
+		} else {
+			if (r->srcSurface != TRACE_NO_SURFACE)
+				r->op.copy.src.bits = surface[r->srcSurface];
+			r->op.copy.dest.bits = surface[r->destSurface];
+		}
+	}
+
+	printf("Replaying %zu operations on %zu surfaces (%.1f MB), %u iterations\n",
+			trace.count, trace.surfaceCount, surfaceBytes / 1048576.0, iterations);
+
+	uint64_t overhead = timerOverhead();
+	for (unsigned i = 0; i < BENCH_WARMUP_RUNS; i++)
+		replay(&trace, overhead, false);
+	for (unsigned i = 0; i < iterations; i++)
+		replay(&trace, overhead, true);
+
+	/* Busiest rules first */
+	uint64_t totalNs = 0, totalCalls = 0, totalPixels = 0;
+	size_t order[COPY_RULES + MATCH_RULES];
+	size_t used = 0;
+	for (size_t i = 0; i < COPY_RULES + MATCH_RULES; i++) {
+		if (totals[i].calls == 0)
+			continue;
+		size_t j;
+		for (j = used; j > 0 && totals[order[j-1]].ns < totals[i].ns; j--)
+			order[j] = order[j-1];
+		order[j] = i;
+		used++;
+		totalNs += totals[i].ns;
+		totalCalls += totals[i].calls;
+		totalPixels += totals[i].pixels;
+	}
+
+	printf("%-24s %10s %14s %12s %7s %10s\n", "Rule", "Calls", "Pixels", "ms/iteration", "Share", "Mpixel/s");
+	for (size_t k = 0; k < used; k++) {
+		size_t i = order[k];
+		const totals_t *t = &totals[i];
+		char name[40];
+		if (i < COPY_RULES)
+			snprintf(name, sizeof name, "%s", combinationRuleName[i]);
+		else
+			snprintf(name, sizeof name, "compare %s", matchRuleName[i - COPY_RULES]);
+		printf("%-24s %10"PRIu64" %14"PRIu64" %12.3f %6.1f%% %10.2f\n",
+				name,
+				t->calls / iterations,
+				t->pixels / iterations,
+				t->ns / 1e6 / iterations,
+				totalNs == 0 ? 0.0 : 100.0 * t->ns / totalNs,
+				t->ns == 0 ? 0.0 : t->pixels * 1e3 / t->ns);
+	}
+	printf("%-24s %10"PRIu64" %14"PRIu64" %12.3f %6.1f%% %10.2f\n",
+			"Total",
+			totalCalls / iterations,
+			totalPixels / iterations,
+			totalNs / 1e6 / iterations,
+			100.0,
+			totalNs == 0 ? 0.0 : totalPixels * 1e3 / totalNs);
+
+	for (size_t i = 0; i < trace.surfaceCount; i++)
+		free(surface[i]);
+	free(surface);
+	bitBltTraceFree(&trace);
+	exit(EXIT_SUCCESS);
+}